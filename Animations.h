@@ -1,4 +1,5 @@
 #include <FastLed.h>
+#include <new>
 
 #if FASTLED_VERSION < 3001000
   #error "Requires FastLED 3.1 or later; check github for latest code."
@@ -10,18 +11,153 @@ uint8_t gHue = 0;
  * Animations
  */
 
+// What an animation gets to render a frame
+typedef struct {
+  uint8_t mArg1;
+  uint8_t mArg2;
+  uint32_t mNow;        // ms
+} FrameContext;
+
+// Animations keep their state in their object, which lives in one of the
+// animation slots for as long as the animation is on. init() is called
+// once when the animation comes on and must set every piece of state, so
+// that entering an animation always looks the same.
+// Buffers too big for the slot come from arena.alloc() in init(), they are
+// given back when the animation goes away. init() can be called again if
+// an allocation failed, render() is only called once they all succeeded:
+// an animation that doesn't fit at all is swapped for a palette fill.
+class AnimationBase {
+
+  public:
+
+    virtual ~AnimationBase() {}
+
+    virtual void init(const FrameContext&) {}
+
+    // Renders a frame into leds, returns its period, see delayType
+    virtual uint8_t render(const FrameContext& ctx) = 0;
+};
+
+// Animations without state are plain functions
 typedef uint8_t (*Animation)(uint8_t arg1, uint8_t arg2);
+
+template <Animation F>
+class StatelessAnimation : public AnimationBase {
+
+  public:
+
+    uint8_t render(const FrameContext& ctx) {
+      return F(ctx.mArg1, ctx.mArg2);
+    }
+};
+
+// Largest animation state, checked at compile time by makeAnimation()
+#define ANIMATION_SLOT_SIZE 96
+
+// Builds an animation into the given slot
+typedef AnimationBase* (*AnimationFactory)(void* slot);
+
+template <class T>
+AnimationBase* makeAnimation(void* slot) {
+  static_assert(sizeof(T) <= ANIMATION_SLOT_SIZE, "Animation state is larger than ANIMATION_SLOT_SIZE");
+  return new (slot) T();
+}
+
+template <Animation F>
+AnimationBase* makeStateless(void* slot) {
+  return makeAnimation<StatelessAnimation<F> >(slot);
+}
+
+// Animations drawn over the pattern, see Compositor.h
+struct LayerPattern;
+
 typedef struct {
-  Animation mPattern;
+  AnimationFactory mFactory;
   uint8_t mArg1;
   uint8_t mArg2;
+  uint8_t mFramePeriod; // target frame period in ms, 0 for FRAME_PERIOD_MS
+  const LayerPattern* mLayers;
+  uint8_t mLayerCount;
 } AnimationPattern;
 
+// The current animation and the one it's transitioning from
+#define ANIMATION_SLOTS 2
+
+// Stands in for an animation whose buffers don't fit in the arena
+uint8_t paletteFill(uint8_t arg1, uint8_t arg2);
+
+class AnimationSlots {
+
+  public:
+
+    AnimationSlots() : _current(0), _outgoingDropped(false) {
+      memset(_animations, 0, sizeof(_animations));
+    }
+
+    // Builds and initializes an animation, it becomes the current one and
+    // the previous current one stays alive until the next start(), unless
+    // the new one needs its scratch memory
+    AnimationBase* start(AnimationFactory factory, const FrameContext& ctx) {
+      uint8_t previous = _current;
+      _current = (_current + 1) % ANIMATION_SLOTS;
+
+      destroy(_current);
+      _outgoingDropped = false;
+
+      _animations[_current] = factory(_slots[_current]);
+      if (!initAnimation(ctx)) {
+        // Not enough scratch memory next to the outgoing animation, it goes
+        // away and there will be no transition
+        destroy(previous);
+        _outgoingDropped = true;
+        if (!initAnimation(ctx)) {
+          // Doesn't fit even on its own
+          _animations[_current]->~AnimationBase();
+          _animations[_current] = makeStateless<paletteFill>(_slots[_current]);
+          initAnimation(ctx);
+        }
+      }
+      return _animations[_current];
+    }
+
+    AnimationBase* getCurrent() { return _animations[_current]; }
+
+    // The animation before the current one, NULL if it had to go
+    AnimationBase* getOutgoing() {
+      if (_outgoingDropped) return NULL;
+      return _animations[(_current + 1) % ANIMATION_SLOTS];
+    }
+
+  private:
+
+    // Arena owner of the slot is the slot index
+    bool initAnimation(const FrameContext& ctx) {
+      arena.release(_current);
+      arena.beginOwner(_current);
+      _animations[_current]->init(ctx);
+      return arena.endOwner();
+    }
+
+    void destroy(uint8_t slot) {
+      if (!_animations[slot]) return;
+      _animations[slot]->~AnimationBase();
+      _animations[slot] = NULL;
+      arena.release(slot);
+    }
+
+    // Word aligned storage for the animation objects
+    uint32_t _slots[ANIMATION_SLOTS][(ANIMATION_SLOT_SIZE + 3) / 4];
+    AnimationBase* _animations[ANIMATION_SLOTS];
+    uint8_t _current;
+    bool _outgoingDropped;
+};
+
+// Any value that is not listed here is a literal frame period in ms
 typedef enum delayType {
-  RANDOM_DELAY = 2,
+  SYNCED_DELAY = 0,   // run at the pattern's target frame period
+  NO_DELAY     = 0,
   STATIC_DELAY = 70,
-  NO_DELAY     = 1,
-  SYNCED_DELAY = 4
+  RANDOM_DELAY = 255  // beat driven frame period
 } delayType;
 
 #define LEFT_STRIP_ONLY  1
@@ -33,37 +169,56 @@ uint8_t gRenderingSettings = BOTH_STRIPS;
 // Fibonacci animations, adapted from https://github.com/evilgeniuslabs/fibonacci-v3d
 #include "FiboMatrix.h" 
 #include "FiboLife.h"
+#include "FiboAutomata.h"
 
 #include "TwinkleFox.h"
 
 
-uint8_t cylon(uint8_t strip, uint8_t num2) {
-  static int step = 0;
-  static bool goingUp = true;
+// @param strip  1 left strip only, 2 right strip only, 3 both strips
+class Cylon : public AnimationBase {
 
-  int lastStep = step;
+  public:
 
-  if (step >= NUM_LEDS) {
-    goingUp = false;
-  } else if (step <= 0) {
-    goingUp = true;
-  }
+    void init(const FrameContext&) {
+      _step = 0;
+      _goingUp = true;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      int lastStep = _step;
+
+      if (_step >= NUM_LEDS) {
+        _goingUp = false;
+      } else if (_step <= 0) {
+        _goingUp = true;
+      }
+
+      if (_goingUp)
+        _step++;
+      else
+        _step--;
 
-  if (goingUp)
-    step++;
-  else
-    step--;
 
+      leds[_step] = CHSV(gHue, 255, 255);
+      leds[lastStep].nscale8(128);
 
-  leds[step] = CHSV(gHue, 255, 255);
-  leds[lastStep].nscale8(128);
+      switch (ctx.mArg1) {
+        case 1: gRenderingSettings = LEFT_STRIP_ONLY; break;
+        case 2: gRenderingSettings = RIGHT_STRIP_ONLY; break;
+        case 3: gRenderingSettings = BOTH_STRIPS; break;
+      };
 
-  switch (strip) {
-    case 1: gRenderingSettings = LEFT_STRIP_ONLY; break;
-    case 2: gRenderingSettings = RIGHT_STRIP_ONLY; break;
-    case 3: gRenderingSettings = BOTH_STRIPS; break;
-  };
+      return SYNCED_DELAY;
+    }
+
+  private:
+
+    int _step;
+    bool _goingUp;
+};
 
+uint8_t paletteFill(uint8_t, uint8_t) {
+  fill_solid(leds, NUM_LEDS, palettes.colorAt(gHue));
   return SYNCED_DELAY;
 }
 
@@ -92,34 +247,60 @@ uint8_t bpm(uint8_t bpmSpeed, uint8_t stripeWidth) {
 
 }
 
-uint8_t sinelon(uint8_t bpmSpeed = 13, uint8_t fadeAmount = 20) {
-  // a colored dot sweeping 
-  // back and forth, with 
-  // fading trails
-  fadeToBlackBy(leds, NUM_LEDS, fadeAmount);
-  int pos = beatsin16(13, 0, NUM_LEDS);
-  static int prevpos = 0;
-  if(pos < prevpos) { 
-    fill_solid(leds+pos, (prevpos-pos)+1, CHSV(gHue, 220, 255));
-  } else { 
-    fill_solid(leds+prevpos, (pos-prevpos)+1, CHSV(gHue, 220, 255));
-  }
-  
-  prevpos = pos;
+// a colored dot sweeping 
+// back and forth, with 
+// fading trails
+// @param arg2  fade amount (20)
+class Sinelon : public AnimationBase {
 
-  return NO_DELAY; 
-}
+  public:
+
+    void init(const FrameContext&) {
+      _prevpos = beatsin16(13, 0, NUM_LEDS);
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      fadeToBlackBy(leds, NUM_LEDS, ctx.mArg2);
+      int pos = beatsin16(13, 0, NUM_LEDS);
+      if(pos < _prevpos) { 
+        fill_solid(leds+pos, (_prevpos-pos)+1, CHSV(gHue, 220, 255));
+      } else { 
+        fill_solid(leds+_prevpos, (pos-_prevpos)+1, CHSV(gHue, 220, 255));
+      }
+      
+      _prevpos = pos;
+
+      return NO_DELAY; 
+    }
+
+  private:
+
+    int _prevpos;
+};
 
 // An animation to play while the crowd goes wild after the big performance
-uint8_t applause(uint8_t minHue, uint8_t maxHue) {
-  static uint16_t lastPixel = 0;
-  fadeToBlackBy(leds, NUM_LEDS, 32);
-  leds[lastPixel] = CHSV(random8(minHue, maxHue), 255, 255);
-  lastPixel = random16(NUM_LEDS);
-  leds[lastPixel] = CRGB::White;
+// @param arg1, arg2  hue range of the faded out pixels
+class Applause : public AnimationBase {
 
-  return RANDOM_DELAY;
-}
+  public:
+
+    void init(const FrameContext&) {
+      _lastPixel = 0;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      fadeToBlackBy(leds, NUM_LEDS, 32);
+      leds[_lastPixel] = CHSV(random8(ctx.mArg1, ctx.mArg2), 255, 255);
+      _lastPixel = random16(NUM_LEDS);
+      leds[_lastPixel] = CRGB::White;
+
+      return RANDOM_DELAY;
+    }
+
+  private:
+
+    uint16_t _lastPixel;
+};
 
 uint8_t confetti(uint8_t colorVariation, uint8_t fadeAmount) {
   // random colored speckles that blink in and fade smoothly
@@ -157,54 +338,120 @@ int wrap(int step) {
 #define RIPPLE_FADE_RATE 255
 // Ripple effect with trailing dots (alternatively), color randomized for each ripple
 // TODO Ripples should be spaced out by some sinus function instead of a static delay to make it feel more organic
-uint8_t ripple(uint8_t rippleSize, uint8_t fadeToBlackRate) {
+// @param arg1  ripple size
+// @param arg2  fade to black rate
+class Ripple : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext&) {
+      _step = -1;
+      _center = 0;
+      _color = 0;
+      _trailingDots = false;
+      _maxSteps = 0;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      uint8_t rippleSize = ctx.mArg1;
+
+      fadeToBlackBy(leds, NUM_LEDS, ctx.mArg2);
 
-  static int step = -1;
-  static int center = 0;  // Center of the current ripple
-  static uint8_t color; // Ripple colour
-  static boolean trailingDots; // whether to add trailing dots to the ripple
-  static int maxSteps;
+      if (_step == -1) {
 
-  fadeToBlackBy(leds, NUM_LEDS, fadeToBlackRate);
+        // Initalizing ripple
+        _center = random(NUM_LEDS);
+        _color = gHue;
+        _maxSteps =  min(random(rippleSize / 2, rippleSize), NUM_LEDS); // Randomize ripple size
+        _trailingDots = random(0, 2) % 2;
+        _step = 0;
 
-  if (step == -1) {
+      } else if (_step == 0) {
 
-    // Initalizing ripple
-    center = random(NUM_LEDS);
-    color = gHue;
-    maxSteps =  min(random(rippleSize / 2, rippleSize), NUM_LEDS); // Randomize ripple size
-    trailingDots = random(0, 2) % 2;
-    step = 0;
+        // First pixel of the ripple
+        leds[_center] = CHSV(_color, 255, 255);
+        _step++;
 
-  } else if (step == 0) {
+      } else if (_step < _maxSteps) {
 
-    // First pixel of the ripple
-    leds[center] = CHSV(color, 255, 255);
-    step++;
+        // In the Ripple
+        uint8_t fading = RIPPLE_FADE_RATE / _step * 2;
+        leds[wrap(_center + _step)] += CHSV(_color + _step, 255, fading); // Display the next pixels in the range for one side.
+        leds[wrap(_center - _step)] += CHSV(_color - _step, 255, fading); // Display the next pixels in the range for the other side.
+        _step++;
 
-  } else if (step < maxSteps) {
+        if (_trailingDots && _step > 3) {
+          // Add trailing dots
+          leds[wrap(_center + _step - 3)] = CHSV(_color - _step, 255, fading);
+          leds[wrap(_center - _step + 3)] = CHSV(_color + _step, 255, fading);
+        }
 
-    // In the Ripple
-    uint8_t fading = RIPPLE_FADE_RATE / step * 2;
-    leds[wrap(center + step)] += CHSV(color + step, 255, fading); // Display the next pixels in the range for one side.
-    leds[wrap(center - step)] += CHSV(color - step, 255, fading); // Display the next pixels in the range for the other side.
-    step++;
+      } else {
+        // Ending the ripple
+        _step = -1;
+      }
 
-    if (trailingDots && step > 3) {
-      // Add trailing dots
-      leds[wrap(center + step - 3)] = CHSV(color - step, 255, fading);
-      leds[wrap(center - step + 3)] = CHSV(color + step, 255, fading);
+      return SYNCED_DELAY;
     }
 
-  } else {
-    // Ending the ripple
-    step = -1;
-  }
+  private:
 
-  return SYNCED_DELAY;
-}
+    int _step;
+    int _center;          // Center of the current ripple
+    uint8_t _color;       // Ripple colour
+    bool _trailingDots;   // whether to add trailing dots to the ripple
+    int _maxSteps;
+};
+
+// Ripple rings spreading over the suit from a random LED
+// @param arg1  largest radius, on the 256x256 coordinates
+// @param arg2  fade rate of the trail
+#define RIPPLE2D_SPEED       6   // radius added per frame
+#define RIPPLE2D_RING_WIDTH 16
+
+class Ripple2D : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext&) {
+      _radius = 0;
+      _maxRadius = 0;
+      _x = 0;
+      _y = 0;
+      _color = 0;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      fadeToBlackBy(leds, NUM_LEDS, ctx.mArg2);
+
+      if (_radius >= _maxRadius) {
+        uint8_t center = random8(NUM_LEDS);
+        _x = ledGeometry.mX[center];
+        _y = ledGeometry.mY[center];
+        _color = gHue;
+        _maxRadius = max(random8(ctx.mArg1 / 2, ctx.mArg1), RIPPLE2D_SPEED);
+        _radius = 0;
+      }
+
+      // Fades out as it spreads
+      uint8_t fading = 255 - (_radius * 255) / _maxRadius;
+      drawRing(_x, _y, _radius, RIPPLE2D_RING_WIDTH, CHSV(_color + _radius / 8, 255, fading));
+
+      _radius = min(_radius + RIPPLE2D_SPEED, 255);
+
+      return SYNCED_DELAY;
+    }
+
+  private:
+
+    uint8_t _radius;
+    uint8_t _maxRadius;
+    uint8_t _x;
+    uint8_t _y;
+    uint8_t _color;
+};
 
-uint8_t beatCubic8x(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highest = 255, int type = 0, int offset = 0)
+uint8_t beatCubic8x(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highest = 255, int /* type */ = 0, int offset = 0)
 {
   uint8_t beat = beat8(beats_per_minute);
   beat += offset;
@@ -224,101 +471,183 @@ uint8_t beatCubic8x(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highes
 // Higher chance = more roaring fire.  Lower chance = more flickery fire.
 // Default 120, suggested range 50-200.
 
-uint8_t fire(uint8_t cooling, uint8_t sparking, const CRGBPalette16& palette) {
+// The heat rises through the LEDs themselves, each LED takes it from the
+// LEDs below it (ledsBelow), so the flames go up on the suit whatever the
+// strip order
+#define HEAT_ROWS        10  // LEDs crossed from the bottom to the top, roughly
+#define HEAT_SPARK_LEDS  10  // LEDs at the bottom where sparks ignite
 
-  // Array of temperature readings at each simulation cell
-  static byte heat[NUM_LEDS];
+// Subclasses pick the palette
+class Fire : public AnimationBase {
 
-  // Step 1.  Cool down every cell a little
-  for (int i = 0; i < NUM_LEDS; i++) {
-    heat[i] = qsub8( heat[i],  random8(0, ((cooling * 10) / NUM_LEDS) + 2));
-  }
+  public:
 
-  // Step 2.  Heat from each cell drifts 'up' and diffuses a little
-  for (int k = NUM_LEDS - 1; k >= 2; k--) {
-    heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2] ) / 3;
-  }
+    void init(const FrameContext&) {
+      _heat = (byte*)arena.alloc(NUM_LEDS);
+      if (_heat) memset(_heat, 0, NUM_LEDS);
+    }
 
-  // Step 3.  Randomly ignite new 'sparks' of heat near the bottom
-  if (random8() < sparking ) {
-    int y = random8(7);
-    heat[y] = qadd8(heat[y], random8(160, 255) );
-  }
+  protected:
 
-  // Step 4.  Map from heat cells to LED colors
-  for ( int j = 0; j < NUM_LEDS; j++) {
-    // Scale the heat value from 0-255 down to 0-240
-    // for best results with color palettes.
-    byte colorindex = scale8(heat[j], 240);
-    leds[j] = ColorFromPalette(palette, colorindex);
-  }
+    // @param up  the heat rises from the bottom, or falls from the top
+    uint8_t fire(uint8_t cooling, uint8_t sparking, const CRGBPalette16& palette, bool up = true) {
+      const uint8_t* sources = up ? ledsBelow.mLeds : ledsAbove.mLeds;
 
-  return STATIC_DELAY;
-}
+      // Step 1.  Cool down every cell a little
+      uint8_t maxCooling = ((cooling * 10) / HEAT_ROWS) + 2;
+      for (int i = 0; i < NUM_LEDS; i++) {
+        _heat[i] = qsub8( _heat[i],  random8(0, maxCooling));
+      }
 
+      // Step 2.  Heat from the LEDs below drifts 'up' and diffuses a little.
+      // Going from the top, the LEDs below still have the last frame's heat.
+      for (int k = 0; k < NUM_LEDS; k++) {
+        uint8_t i = ledsTopDown.mLeds[up ? k : NUM_LEDS - 1 - k];
+        uint8_t nearest = sources[i * LED_SOURCES];
+        uint8_t second = sources[i * LED_SOURCES + 1];
 
+        // The bottom edge keeps its heat, that's where the sparks are
+        if (nearest == XY_NO_LED) continue;
+        if (second == XY_NO_LED) second = nearest;
 
+        _heat[i] = (_heat[nearest] * 3 + _heat[second]) >> 2;
+      }
 
-uint8_t blueFire(uint8_t cooling, uint8_t sparking) {
-  static const CRGBPalette16 bluePalette = CRGBPalette16(CRGB::Black, CRGB::Blue, CRGB::Aqua,  CRGB::White);
-  return fire(cooling, sparking, bluePalette);
-}
+      // Step 3.  Randomly ignite new 'sparks' of heat near the bottom
+      if (random8() < sparking ) {
+        uint8_t k = random8(HEAT_SPARK_LEDS);
+        uint8_t y = ledsTopDown.mLeds[up ? NUM_LEDS - 1 - k : k];
+        _heat[y] = qadd8(_heat[y], random8(160, 255) );
+      }
 
-uint8_t multiFire(uint8_t cooling, uint8_t sparking) {
-  CRGB darkcolor  = CHSV(gHue, 255, 192); // pure hue, three-quarters brightness
-  CRGB lightcolor = CHSV(gHue, 128, 255); // half 'whitened', full brightness
-  const CRGBPalette16 pal = CRGBPalette16(CRGB::Black, darkcolor, lightcolor, CRGB::White);
+      // Step 4.  Map from heat cells to LED colors
+      for ( int j = 0; j < NUM_LEDS; j++) {
+        // Scale the heat value from 0-255 down to 0-240
+        // for best results with color palettes.
+        byte colorindex = scale8(_heat[j], 240);
+        leds[j] = ColorFromPalette(palette, colorindex);
+      }
 
-  return fire(cooling, sparking, pal);
-}
+      return STATIC_DELAY;
+    }
 
-uint8_t multiFire2(uint8_t cooling, uint8_t sparking) { 
-  return fire(cooling, sparking, palettes.getGradientPalette());
-}
+  private:
+
+    // Array of temperature readings at each LED, NUM_LEDS in the scratch arena
+    byte* _heat;
+};
+
+const CRGBPalette16 BlueFireColors_p = CRGBPalette16(CRGB::Black, CRGB::Blue, CRGB::Aqua,  CRGB::White);
+
+class BlueFire : public Fire {
+
+  public:
+
+    uint8_t render(const FrameContext& ctx) {
+      return fire(ctx.mArg1, ctx.mArg2, BlueFireColors_p);
+    }
+};
+
+class MultiFire : public Fire {
+
+  public:
+
+    uint8_t render(const FrameContext& ctx) {
+      CRGB darkcolor  = CHSV(gHue, 255, 192); // pure hue, three-quarters brightness
+      CRGB lightcolor = CHSV(gHue, 128, 255); // half 'whitened', full brightness
+      const CRGBPalette16 pal = CRGBPalette16(CRGB::Black, darkcolor, lightcolor, CRGB::White);
+
+      return fire(ctx.mArg1, ctx.mArg2, pal);
+    }
+};
+
+class MultiFire2 : public Fire {
+
+  public:
+
+    uint8_t render(const FrameContext& ctx) {
+      return fire(ctx.mArg1, ctx.mArg2, palettes.getGradientPalette());
+    }
+};
+
+// Fibonacci fire, from the heat map of https://github.com/evilgeniuslabs/fibonacci-v3d
+class FiboFire : public Fire {
+
+  public:
+
+    uint8_t render(const FrameContext&) {
+      fire(55, 120, HeatColors_p);
+      return RANDOM_DELAY;
+    }
+};
+
+// Way too fast
+class Water : public Fire {
+
+  public:
+
+    uint8_t render(const FrameContext&) {
+      fire(55, 120, IceColors_p, false);
+      return SYNCED_DELAY;
+    }
+};
 
 // From Marks Kriegman's https://gist.github.com/kriegsman/964de772d64c502760e5
-uint8_t pride(uint8_t a, uint8_t b) {
-  static uint16_t sPseudotime = 0;
-  static uint16_t sLastMillis = 0;
-  static uint16_t sHue16 = 0;
+class Pride : public AnimationBase {
 
-  uint8_t sat8 = beatsin88(87, 220, 250);
-  uint8_t brightdepth = beatsin88(341, 96, 224);
-  uint16_t brightnessthetainc16 = beatsin88(203, (25 * 256), (40 * 256));
-  uint8_t msmultiplier = beatsin88(147, 23, 60);
+  public:
 
-  uint16_t hue16 = sHue16;//gHue * 256;
-  uint16_t hueinc16 = beatsin88(113, 1, 3000);
+    void init(const FrameContext& ctx) {
+      _pseudotime = 0;
+      _lastMillis = ctx.mNow;
+      _hue16 = 0;
+    }
 
-  uint16_t ms = millis();
-  uint16_t deltams = ms - sLastMillis ;
-  sLastMillis  = ms;
-  sPseudotime += deltams * msmultiplier;
-  sHue16 += deltams * beatsin88( 400, 5, 9);
-  uint16_t brightnesstheta16 = sPseudotime;
+    uint8_t render(const FrameContext& ctx) {
+      uint8_t sat8 = beatsin88(87, 220, 250);
+      uint8_t brightdepth = beatsin88(341, 96, 224);
+      uint16_t brightnessthetainc16 = beatsin88(203, (25 * 256), (40 * 256));
+      uint8_t msmultiplier = beatsin88(147, 23, 60);
 
-  for (uint16_t i = 0 ; i < NUM_LEDS; i++) {
+      uint16_t hue16 = _hue16;//gHue * 256;
+      uint16_t hueinc16 = beatsin88(113, 1, 3000);
 
-    hue16 += hueinc16;
-    uint8_t hue8 = hue16 / 256;
+      uint16_t ms = ctx.mNow;
+      uint16_t deltams = ms - _lastMillis ;
+      _lastMillis  = ms;
+      _pseudotime += deltams * msmultiplier;
+      _hue16 += deltams * beatsin88( 400, 5, 9);
+      uint16_t brightnesstheta16 = _pseudotime;
 
-    brightnesstheta16  += brightnessthetainc16;
-    uint16_t b16 = sin16( brightnesstheta16  ) + 32768;
+      for (uint16_t i = 0 ; i < NUM_LEDS; i++) {
 
-    uint16_t bri16 = (uint32_t)((uint32_t)b16 * (uint32_t)b16) / 65536;
-    uint8_t bri8 = (uint32_t)(((uint32_t)bri16) * brightdepth) / 65536;
-    bri8 += (255 - brightdepth);
+        hue16 += hueinc16;
+        uint8_t hue8 = hue16 / 256;
 
-    CRGB newcolor = CHSV(hue8, sat8, bri8);
+        brightnesstheta16  += brightnessthetainc16;
+        uint16_t b16 = sin16( brightnesstheta16  ) + 32768;
 
-    uint16_t pixelnumber = i;
-    pixelnumber = (NUM_LEDS - 1) - pixelnumber;
+        uint16_t bri16 = (uint32_t)((uint32_t)b16 * (uint32_t)b16) / 65536;
+        uint8_t bri8 = (uint32_t)(((uint32_t)bri16) * brightdepth) / 65536;
+        bri8 += (255 - brightdepth);
 
-    nblend(leds[pixelnumber], newcolor, 64);
-  }
+        CRGB newcolor = CHSV(hue8, sat8, bri8);
 
-  return STATIC_DELAY;
-}
+        uint16_t pixelnumber = i;
+        pixelnumber = (NUM_LEDS - 1) - pixelnumber;
+
+        nblend(leds[pixelnumber], newcolor, 64);
+      }
+
+      return STATIC_DELAY;
+    }
+
+  private:
+
+    uint16_t _pseudotime;
+    uint16_t _lastMillis;
+    uint16_t _hue16;
+};
 
 
 
@@ -326,7 +655,7 @@ uint8_t pride(uint8_t a, uint8_t b) {
    Touch Animations
 */
 
-uint8_t fadeOut(uint8_t fadeAmount, uint8_t b) {
+uint8_t fadeOut(uint8_t fadeAmount, uint8_t) {
   fadeToBlackBy(leds, NUM_LEDS, fadeAmount);
   return STATIC_DELAY;
 }
@@ -363,137 +692,160 @@ static void drawRainbowDashes(
   }
 }
 
-// discoWorker updates the positions of the dashes, and calls the draw function
-//
-void discoWorker(
-  uint8_t dashperiod, uint8_t dashwidth, int8_t  dashmotionspeed,
-  uint8_t stroberepeats,
-  uint8_t huedelta)
-{
-  static uint8_t sRepeatCounter = 0;
-  static int8_t sStartPosition = 0;
-  static uint8_t sStartHue = 0;
-
-  // Always keep the hue shifting a little
-  sStartHue += 1;
-
-  // Increment the strobe repeat counter, and
-  // move the dash starting position when needed.
-  sRepeatCounter = sRepeatCounter + 1;
-  if ( sRepeatCounter >= stroberepeats) {
-    sRepeatCounter = 0;
-
-    sStartPosition = sStartPosition + dashmotionspeed;
-
-    // These adjustments take care of making sure that the
-    // starting hue is adjusted to keep the apparent color of
-    // each dash the same, even when the state position wraps around.
-    if ( sStartPosition >= dashperiod ) {
-      while ( sStartPosition >= dashperiod) {
-        sStartPosition -= dashperiod;
-      }
-      sStartHue  -= huedelta;
-    } else if ( sStartPosition < 0) {
-      while ( sStartPosition < 0) {
-        sStartPosition += dashperiod;
+// Dashes of rainbow light zooming back and forth under a strobe
+// @param arg1  zoom BPM (120)
+// @param arg2  strobe cycle length, light every Nth frame (4)
+class DiscoStrobe : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext&) {
+      _repeatCounter = 0;
+      _startPosition = 0;
+      _startHue = 0;
+      _strobePhase = 0;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      return discostrobe(ctx.mArg1, ctx.mArg2);
+    }
+
+  protected:
+
+    // discoWorker updates the positions of the dashes, and calls the draw function
+    //
+    void discoWorker(
+      uint8_t dashperiod, uint8_t dashwidth, int8_t  dashmotionspeed,
+      uint8_t stroberepeats,
+      uint8_t huedelta)
+    {
+      // Always keep the hue shifting a little
+      _startHue += 1;
+
+      // Increment the strobe repeat counter, and
+      // move the dash starting position when needed.
+      _repeatCounter = _repeatCounter + 1;
+      if ( _repeatCounter >= stroberepeats) {
+        _repeatCounter = 0;
+
+        _startPosition = _startPosition + dashmotionspeed;
+
+        // These adjustments take care of making sure that the
+        // starting hue is adjusted to keep the apparent color of
+        // each dash the same, even when the state position wraps around.
+        if ( _startPosition >= dashperiod ) {
+          while ( _startPosition >= dashperiod) {
+            _startPosition -= dashperiod;
+          }
+          _startHue  -= huedelta;
+        } else if ( _startPosition < 0) {
+          while ( _startPosition < 0) {
+            _startPosition += dashperiod;
+          }
+          _startHue  += huedelta;
+        }
       }
-      sStartHue  += huedelta;
+
+      // draw dashes with full brightness (value), and somewhat
+      // desaturated (whitened) so that the LEDs actually throw more light.
+      const uint8_t kSaturation = 208;
+      const uint8_t kValue = 255;
+
+      // call the function that actually just draws the dashes now
+      drawRainbowDashes( _startPosition, NUM_LEDS - 1,
+                         dashperiod, dashwidth,
+                         _startHue, huedelta,
+                         kSaturation, kValue);
     }
-  }
 
-  // draw dashes with full brightness (value), and somewhat
-  // desaturated (whitened) so that the LEDs actually throw more light.
-  const uint8_t kSaturation = 208;
-  const uint8_t kValue = 255;
 
-  // call the function that actually just draws the dashes now
-  drawRainbowDashes( sStartPosition, NUM_LEDS - 1,
-                     dashperiod, dashwidth,
-                     sStartHue, huedelta,
-                     kSaturation, kValue);
-}
+    uint8_t discostrobe(uint8_t zoomBPM, uint8_t strobeCycleLength) {
+      // First, we black out all the LEDs
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
 
+      // To achive the strobe effect, we actually only draw lit pixels
+      // every Nth frame (e.g. every 4th frame).
+      // _strobePhase is a counter that runs from zero to strobeCycleLength-1,
+      // and then resets to zero.
 
-uint8_t discostrobe(uint8_t zoomBPM = 120, uint8_t strobeCycleLength = 4) {
-  // First, we black out all the LEDs
-  fill_solid(leds, NUM_LEDS, CRGB::Black);
+      // strobeCycleLength = 4; //  light every Nth frame
+      _strobePhase = _strobePhase + 1;
+      if ( _strobePhase >= strobeCycleLength ) {
+        _strobePhase = 0;
+      }
 
-  // To achive the strobe effect, we actually only draw lit pixels
-  // every Nth frame (e.g. every 4th frame).
-  // sStrobePhase is a counter that runs from zero to strobeCycleLength-1,
-  // and then resets to zero.
+      // We only draw lit pixels when we're in strobe phase zero;
+      // in all the other phases we leave the LEDs all black.
+      if (_strobePhase == 0) {
+
+        // The dash spacing cycles from 4 to 9 and back, 8x/min (about every 7.5 sec)
+        uint8_t dashperiod = beatsin8( 8/*cycles per minute*/, 4, 10);
+        // The width of the dashes is a fraction of the dashperiod, with a minimum of one pixel
+        uint8_t dashwidth = (dashperiod / 4) + 1;
+
+        // The distance that the dashes move each cycles varies
+        // between 1 pixel/cycle and half-the-dashperiod/cycle.
+        // At the maximum speed, it's impossible to visually distinguish
+        // whether the dashes are moving left or right, and the code takes
+        // advantage of that moment to reverse the direction of the dashes.
+        // So it looks like they're speeding up faster and faster to the
+        // right, and then they start slowing down, but as they do it becomes
+        // visible that they're no longer moving right; they've been
+        // moving left.  Easier to see than t o explain.
+        //
+        // The dashes zoom back and forth at a speed that 'goes well' with
+        // most dance music, a little faster than 120 Beats Per Minute.  You
+        // can adjust this for faster or slower 'zooming' back and forth.
+        int8_t  dashmotionspeed = beatsin8( (zoomBPM / 2), 1, dashperiod);
+        // This is where we reverse the direction under cover of high speed
+        // visual aliasing.
+        if ( dashmotionspeed >= (dashperiod / 2)) {
+          dashmotionspeed = 0 - (dashperiod - dashmotionspeed );
+        }
 
-  // strobeCycleLength = 4; //  light every Nth frame
-  static uint8_t sStrobePhase = 0;
-  sStrobePhase = sStrobePhase + 1;
-  if ( sStrobePhase >= strobeCycleLength ) {
-    sStrobePhase = 0;
-  }
 
-  // We only draw lit pixels when we're in strobe phase zero;
-  // in all the other phases we leave the LEDs all black.
-  if (sStrobePhase == 0) {
-
-    // The dash spacing cycles from 4 to 9 and back, 8x/min (about every 7.5 sec)
-    uint8_t dashperiod = beatsin8( 8/*cycles per minute*/, 4, 10);
-    // The width of the dashes is a fraction of the dashperiod, with a minimum of one pixel
-    uint8_t dashwidth = (dashperiod / 4) + 1;
-
-    // The distance that the dashes move each cycles varies
-    // between 1 pixel/cycle and half-the-dashperiod/cycle.
-    // At the maximum speed, it's impossible to visually distinguish
-    // whether the dashes are moving left or right, and the code takes
-    // advantage of that moment to reverse the direction of the dashes.
-    // So it looks like they're speeding up faster and faster to the
-    // right, and then they start slowing down, but as they do it becomes
-    // visible that they're no longer moving right; they've been
-    // moving left.  Easier to see than t o explain.
-    //
-    // The dashes zoom back and forth at a speed that 'goes well' with
-    // most dance music, a little faster than 120 Beats Per Minute.  You
-    // can adjust this for faster or slower 'zooming' back and forth.
-    int8_t  dashmotionspeed = beatsin8( (zoomBPM / 2), 1, dashperiod);
-    // This is where we reverse the direction under cover of high speed
-    // visual aliasing.
-    if ( dashmotionspeed >= (dashperiod / 2)) {
-      dashmotionspeed = 0 - (dashperiod - dashmotionspeed );
-    }
-
-
-    // The hueShift controls how much the hue of each dash varies from
-    // the adjacent dash.  If hueShift is zero, all the dashes are the
-    // same color. If hueShift is 128, alterating dashes will be two
-    // different colors.  And if hueShift is range of 10..40, the
-    // dashes will make rainbows.
-    // Initially, I just had hueShift cycle from 0..130 using beatsin8.
-    // It looked great with very low values, and with high values, but
-    // a bit 'busy' in the middle, which I didnt like.
-    //   uint8_t hueShift = beatsin8(2,0,130);
-    //
-    // So instead I layered in a bunch of 'cubic easings'
-    // (see http://easings.net/#easeInOutCubic )
-    // so that the resultant wave cycle spends a great deal of time
-    // "at the bottom" (solid color dashes), and at the top ("two
-    // color stripes"), and makes quick transitions between them.
-    uint8_t cycle = beat8(2); // two cycles per minute
-    uint8_t easedcycle = ease8InOutCubic( ease8InOutCubic( cycle));
-    uint8_t wavecycle = cubicwave8( easedcycle);
-    uint8_t hueShift = scale8( wavecycle, 130);
-
-
-    // Each frame of the animation can be repeated multiple times.
-    // This slows down the apparent motion, and gives a more static
-    // strobe effect.  After experimentation, I set the default to 1.
-    uint8_t strobesPerPosition = 1; // try 1..4
-
-
-    // Now that all the parameters for this frame are calculated,
-    // we call the 'worker' function that does the next part of the work.
-    discoWorker(dashperiod, dashwidth, dashmotionspeed, strobesPerPosition, hueShift);
-  }
+        // The hueShift controls how much the hue of each dash varies from
+        // the adjacent dash.  If hueShift is zero, all the dashes are the
+        // same color. If hueShift is 128, alterating dashes will be two
+        // different colors.  And if hueShift is range of 10..40, the
+        // dashes will make rainbows.
+        // Initially, I just had hueShift cycle from 0..130 using beatsin8.
+        // It looked great with very low values, and with high values, but
+        // a bit 'busy' in the middle, which I didnt like.
+        //   uint8_t hueShift = beatsin8(2,0,130);
+        //
+        // So instead I layered in a bunch of 'cubic easings'
+        // (see http://easings.net/#easeInOutCubic )
+        // so that the resultant wave cycle spends a great deal of time
+        // "at the bottom" (solid color dashes), and at the top ("two
+        // color stripes"), and makes quick transitions between them.
+        uint8_t cycle = beat8(2); // two cycles per minute
+        uint8_t easedcycle = ease8InOutCubic( ease8InOutCubic( cycle));
+        uint8_t wavecycle = cubicwave8( easedcycle);
+        uint8_t hueShift = scale8( wavecycle, 130);
+
+
+        // Each frame of the animation can be repeated multiple times.
+        // This slows down the apparent motion, and gives a more static
+        // strobe effect.  After experimentation, I set the default to 1.
+        uint8_t strobesPerPosition = 1; // try 1..4
+
+
+        // Now that all the parameters for this frame are calculated,
+        // we call the 'worker' function that does the next part of the work.
+        discoWorker(dashperiod, dashwidth, dashmotionspeed, strobesPerPosition, hueShift);
+      }
 
-  return SYNCED_DELAY;
-}
+      return SYNCED_DELAY;
+    }
+
+  private:
+
+    uint8_t _repeatCounter;
+    int8_t _startPosition;
+    uint8_t _startHue;
+    uint8_t _strobePhase;
+};
 
 void fadeAndTwinkleBlood(int fadeVal) {
   for (int i = 0; i < NUM_LEDS; i++) {
@@ -513,252 +865,433 @@ void fadeAndTwinkleBlood(int fadeVal) {
   }
 }
 
-// Watch out: this function calls "show/show_at_max_brightness" itself 
-// to be an independent, blocking animation
-void showBeat(int animLength) {
+// Heartbeat feedback composited over the running animation, one step per frame.
+// The first phase (red) lights up at once, the second one (blue) cell by cell.
+typedef struct {
+  uint32_t mStart;   // ms
+  uint16_t mLength;  // ms, 0 when no beat is showing
+  uint8_t  mSeed;    // keeps the per cell noise stable during a beat
+} BeatOverlay;
 
-  const uint8_t numLedsForFirstPhase = 40; 
-  int timeForBloodCells = animLength / NUM_LEDS;
-  
-  fadeAndTwinkleBlood(100);
+BeatOverlay gBeat = {0, 0, 0};
 
-  for (int i = 0; i < NUM_LEDS; i++) {
+void startBeat(uint16_t animLength) {
+  gBeat.mStart = millis();
+  gBeat.mLength = animLength;
+  gBeat.mSeed = random8();
+}
+
+void drawBeatOverlay() {
+  if (gBeat.mLength == 0) return;
+
+  const uint8_t numLedsForFirstPhase = 40;
+
+  uint32_t elapsed = millis() - gBeat.mStart;
+  if (elapsed >= gBeat.mLength) {
+    gBeat.mLength = 0;
+    return;
+  }
+
+  // Cells revealed so far
+  uint8_t revealed = max((uint32_t)numLedsForFirstPhase + 1, elapsed * NUM_LEDS / gBeat.mLength);
+
+  for (uint8_t i = 0; i < revealed; i++) {
+    uint8_t noise = sin8(i * 37 + gBeat.mSeed);
+    // Older cells have been fading for longer
+    uint8_t level = 255 - (revealed - i);
 
-    if (i % 2 == 0) {
-      fadeAndTwinkleBlood(5);
-    }
-    
-    // First phase
     if (i <= numLedsForFirstPhase) {
-      leds[i].r = random8();
-      if (i == numLedsForFirstPhase) {
-        // End of first phase, show it at once
-        show_at_max_brightness_for_power();
-        delay_at_max_brightness_for_power(timeForBloodCells * numLedsForFirstPhase);
-      }
+      leds[i].r = scale8(noise, level);
     } else {
-      // Second phase (show cell by cell)
-      leds[i].b = random8(120);
-      show_at_max_brightness_for_power();
-      delay_at_max_brightness_for_power(timeForBloodCells);
+      leds[i].b = scale8(scale8(noise, 120), level);
     }
-     
   }
 }
 
 
-uint8_t beatTriggered(uint8_t delayBetweenHeartbeats /*multiplied by 100, default: 16 */, uint8_t delayBetweenPhases /*100*/) {
-  
-  // Heartbeat is usually around 60-90 for adults
-  // Systole - X (1/3 of the time)
-  // Diastole - relaxation (2/3 of the time)
+// @param arg1  delay between heartbeats, multiplied by 100 (16)
+// @param arg2  delay between the two phases of a beat (100)
+class BeatTriggered : public AnimationBase {
 
-  static uint8_t step = -1;
+  public:
 
-  static boolean beatInProgress = true;
-  uint8_t wantedDelay = NO_DELAY;
+    void init(const FrameContext& ctx) {
+      _step = -1;
+      _beatInProgress = true;
+      _lastBeat = ctx.mNow;
+    }
 
-  // TODO Check that this works since it's using a macro
-  EVERY_N_MILLISECONDS(delayBetweenHeartbeats * 100) {
-    beatInProgress = true;
-  }
+    uint8_t render(const FrameContext& ctx) {
+      
+      // Heartbeat is usually around 60-90 for adults
+      // Systole - X (1/3 of the time)
+      // Diastole - relaxation (2/3 of the time)
 
-  if (beatInProgress) {
+      uint8_t delayBetweenPhases = ctx.mArg2;
+      uint8_t wantedDelay = NO_DELAY;
 
-    step++;
+      if (ctx.mNow - _lastBeat >= ctx.mArg1 * 100UL) {
+        _lastBeat = ctx.mNow;
+        _beatInProgress = true;
+      }
 
-    if (step <= 40) {
-      // Systole paint with redish blood
-      //leds[step] = ColorFromPalette(gCurrentGradientPalette, 90 + map(step, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
-      leds[step] = ColorFromPalette(palettes.getPalette(), 90 + map(step, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
-      if (random8(2) % 2) leds[step].r = random8();
-      
-      if (step == 40) {
-        wantedDelay = delayBetweenPhases;
+      if (_beatInProgress) {
+
+        _step++;
+
+        if (_step <= 40) {
+          // Systole paint with redish blood
+          //leds[step] = ColorFromPalette(gCurrentGradientPalette, 90 + map(step, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
+          leds[_step] = palettes.colorAt(90 + map(_step, 0, NUM_LEDS-1, 0, 255), 100);
+          if (random8(2) % 2) leds[_step].r = random8();
+          
+          if (_step == 40) {
+            wantedDelay = delayBetweenPhases;
+          }
+        } else if (_step <= 100) {
+          // Diastole painted with blueish blood
+          leds[_step] = palettes.colorAt(180 + map(_step, 0, NUM_LEDS-1, 0, 255), 100);
+          if (random8(2) % 2) leds[_step].b = random8(120);
+          
+          if (_step == 100) {
+            // Finished heart beat
+            _beatInProgress = false;
+            wantedDelay = delayBetweenPhases;
+            _step = -1;
+          }
+        }
+
+        if (_step % 3 == 0) {
+          fadeAndTwinkleBlood(5);
+        }
+
+      } else {
+        fadeAndTwinkleBlood(5);
+      }
+
+
+      return wantedDelay;
+    }
+
+  private:
+
+    uint8_t _step;
+    bool _beatInProgress;
+    uint32_t _lastBeat;
+};
+
+class Breathing : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext&) {
+      _inhale = true;
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      uint8_t bpmSpeed = ctx.mArg1;
+
+      int length = beatCubic8x(bpmSpeed, 0, NUM_LEDS, 3);
+      int light = beatCubic8x(bpmSpeed, 100, 200, 3);
+
+      if (_inhale) {
+        gRenderingSettings = BOTH_STRIPS;
+        leds[length] = CHSV(HUE_BLUE, 255, light);
+        leds[length].b = random8(120);
+      } else {
+        gRenderingSettings = RIGHT_STRIP_ONLY;
+        for (int i = 0; i < length; i++) {
+          leds[i] = CHSV(HUE_RED, 255, light);
+          leds[length].r = random8();
+        }
+
+        if (length % 3) {
+          for (int i = 0; i < length; i++) {
+            if (leds[i].r > 10) {
+              if (random8(100) < 20) {
+                leds[i].r = 80;
+                leds[i].g = 20;
+              }
+            }
+          }
+        }
+
+        fadeAndTwinkleBlood(light); 
+        //fadeToBlackBy(leds, NUM_LEDS, light);
       }
-    } else if (step <= 100) {
-      // Diastole painted with blueish blood
-      leds[step] = ColorFromPalette(palettes.getPalette(), 180 + map(step, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
-      if (random8(2) % 2) leds[step].b = random8(120);
+
       
-      if (step == 100) {
-        // Finished heart beat
-        beatInProgress = false;
-        wantedDelay = delayBetweenPhases;
-        step = -1;
+      if (length == 0) {
+        _inhale = false;
+      } else if (length == NUM_LEDS - 1) {
+        _inhale = true;
       }
-    }
 
-    if (step % 3 == 0) {
-      fadeAndTwinkleBlood(5);
+      return STATIC_DELAY;
     }
 
-  } else {
-    fadeAndTwinkleBlood(5);
-  }
+  private:
 
+    bool _inhale;
+};
 
-  return wantedDelay;
-}
 
-uint8_t breathing(uint8_t bpmSpeed, uint8_t fadeAmount) {
 
-  int length = beatCubic8x(bpmSpeed, 0, NUM_LEDS, 3);
-  int light = beatCubic8x(bpmSpeed, 100, 200, 3);
+// new animation to try
+
+class Juggle2 : public AnimationBase {
 
-  static bool inhale = true;
+  public:
 
-  if (inhale) {
-    gRenderingSettings = BOTH_STRIPS;
-    leds[length] = CHSV(HUE_BLUE, 255, light);
-    leds[length].b = random8(120);
-  } else {
-    gRenderingSettings = RIGHT_STRIP_ONLY;
-    for (int i = 0; i < length; i++) {
-      leds[i] = CHSV(HUE_RED, 255, light);
-      leds[length].r = random8();
+    void init(const FrameContext&) {
+      _numdots =   4; // Number of dots in use.
+      _faderate =   2; // How long should the trails be. Very low value = longer trails.
+      _hueinc =  255 / _numdots - 1; // Incremental change in hue between each dot.
+      _thishue =   0; // Starting hue.
+      _basebeat =   5; // Higher = faster movement.
+      _lastSecond =  99;  // our 'debounce' variable.
     }
 
-    if (length % 3) {
-      for (int i = 0; i < length; i++) {
-        if (leds[i].r > 10) {
-          if (random8(100) < 20) {
-            leds[i].r = 80;
-            leds[i].g = 20;
-          }
+    uint8_t render(const FrameContext& ctx) {
+      const uint8_t thissat = 255; // Saturation of the colour.
+      const uint8_t thisbright = 255; // How bright should the LED/display be.
+
+      uint8_t secondHand = (ctx.mNow / 1000) % 30; // IMPORTANT!!! Change '30' to a different value to change duration of the loop.
+
+      if (_lastSecond != secondHand) { // Debounce to make sure we're not repeating an assignment.
+        _lastSecond = secondHand;
+        switch (secondHand) {
+          case  0: _numdots = 1; _basebeat = 20; _hueinc = 16; _faderate = 2; _thishue = 0; break; // You can change values here, one at a time , or altogether.
+          case 10: _numdots = 4; _basebeat = 10; _hueinc = 16; _faderate = 8; _thishue = 128; break;
+          case 20: _numdots = 8; _basebeat =  3; _hueinc =  0; _faderate = 8; _thishue = random8(); break; // Only gets called once, and not continuously for the next several seconds. Therefore, no rainbows.
+          case 30: break;
         }
       }
+
+      // Several colored dots, weaving in and out of sync with each other
+      uint8_t curhue = _thishue; // Reset the hue values.
+      fadeToBlackBy(leds, NUM_LEDS, _faderate);
+      for ( int i = 0; i < _numdots; i++) {
+        //beat16 is a FastLED 3.1 function
+        leds[beatsin16(_basebeat + i + _numdots, 0, NUM_LEDS)] += CHSV(gHue + curhue, thissat, thisbright);
+        curhue += _hueinc;
+      }
+
+      return 8;
     }
 
-    fadeAndTwinkleBlood(light); 
-    //fadeToBlackBy(leds, NUM_LEDS, light);
-  }
+  private:
 
-  
-  if (length == 0) {
-    inhale = false;
-  } else if (length == NUM_LEDS - 1) {
-    inhale = true;
-  }
+    uint8_t _numdots;
+    uint8_t _faderate;
+    uint8_t _hueinc;
+    uint8_t _thishue;
+    uint8_t _basebeat;
+    uint8_t _lastSecond;
+};
 
-  return STATIC_DELAY;
-}
 
+// @param arg1  starting speed (6)
+// @param arg2  starting density (1)
+class TwinkleFoxAnimation : public AnimationBase {
 
+  public:
 
-// new animation to try
+    TwinkleFoxAnimation() : _blendTimer(10), _changeTimer(10000) {}
 
-uint8_t juggle2(uint8_t a, uint8_t b)
-{
-  static uint8_t    numdots =   4; // Number of dots in use.
-  static uint8_t   faderate =   2; // How long should the trails be. Very low value = longer trails.
-  static uint8_t     hueinc =  255 / numdots - 1; // Incremental change in hue between each dot.
-  static uint8_t    thishue =   0; // Starting hue.
-  static uint8_t     curhue =   0; // The current hue
-  static uint8_t    thissat = 255; // Saturation of the colour.
-  static uint8_t thisbright = 255; // How bright should the LED/display be.
-  static uint8_t   basebeat =   5; // Higher = faster movement.
-
-  static uint8_t lastSecond =  99;  // Static variable, means it's only defined once. This is our 'debounce' variable.
-  uint8_t secondHand = (millis() / 1000) % 30; // IMPORTANT!!! Change '30' to a different value to change duration of the loop.
-
-  if (lastSecond != secondHand) { // Debounce to make sure we're not repeating an assignment.
-    lastSecond = secondHand;
-    switch (secondHand) {
-      case  0: numdots = 1; basebeat = 20; hueinc = 16; faderate = 2; thishue = 0; break; // You can change values here, one at a time , or altogether.
-      case 10: numdots = 4; basebeat = 10; hueinc = 16; faderate = 8; thishue = 128; break;
-      case 20: numdots = 8; basebeat =  3; hueinc =  0; faderate = 8; thishue = random8(); break; // Only gets called once, and not continuously for the next several seconds. Therefore, no rainbows.
-      case 30: break;
+    void init(const FrameContext& ctx) {
+      _tspeed = ctx.mArg1;
+      _tdensity = ctx.mArg2;
+      _blendTimer.reset();
+      _changeTimer.reset();
     }
-  }
 
-  // Several colored dots, weaving in and out of sync with each other
-  curhue = thishue; // Reset the hue values.
-  fadeToBlackBy(leds, NUM_LEDS, faderate);
-  for ( int i = 0; i < numdots; i++) {
-    //beat16 is a FastLED 3.1 function
-    leds[beatsin16(basebeat + i + numdots, 0, NUM_LEDS)] += CHSV(gHue + curhue, thissat, thisbright);
-    curhue += hueinc;
-  }
+    uint8_t render(const FrameContext&) {
+      
+      if (_blendTimer) {
+        nblendPaletteTowardPalette( currentTwinklePalette, targetTwinklePalette, 12);
+      }
 
-  return 8;
-}
+      if (_changeTimer) { 
+        chooseNextColorPalette( targetTwinklePalette );
+        
+        _tspeed = max((_tspeed + 1) % 9, 6);
+        _tdensity = max((_tdensity + 1) % 9, 1); 
+        PRINTX("Speed:", _tspeed); 
+        PRINTX("Density:", _tdensity); 
+      }
+      drawTwinkles(_tspeed, _tdensity);
 
+      return NO_DELAY;
+    }
 
-uint8_t twinkleFox(uint8_t defaultSpeed = 6, uint8_t defaultDensity = 1) {
-  
-  EVERY_N_MILLISECONDS( 10 ) {
-    nblendPaletteTowardPalette( currentTwinklePalette, targetTwinklePalette, 12);
-  }
+  private:
 
-  static int tspeed = defaultSpeed;
-  static int tdensity = defaultDensity;
-  
-  EVERY_N_SECONDS(10) { 
-    chooseNextColorPalette( targetTwinklePalette );
-    
-    tspeed = max((tspeed + 1) % 9, 6);
-    tdensity = max((tdensity + 1) % 9, 1); 
-    PRINTX("Speed:", tspeed); 
-    PRINTX("Density:", tdensity); 
-  }
-  drawTwinkles(tspeed, tdensity);
-
-  return NO_DELAY;
-}
+    CEveryNMillis _blendTimer;
+    CEveryNMillis _changeTimer;
+    int _tspeed;
+    int _tdensity;
+};
 
 
 /*
    Drop Animations
 */
 
-uint8_t aboutToDropBPM = 1; 
-uint8_t aboutToDropDots = 255;
-
-void initDropAnimations() { 
-  // reset 
-  aboutToDropBPM = 1;
-  aboutToDropDots = 30; 
-}
-
 // TODO Placeholder animation. Need real progress bar action
 // TODO Maybe try CRGB HeatColor(uint8_t temperature) with a rising temp
 // or focus on the middle and expand from there
-uint8_t aboutToDrop(uint8_t a, uint8_t b) {
+class AboutToDrop : public AnimationBase {
 
-  // increase BPM
-  EVERY_N_MILLISECONDS(500) { aboutToDropDots = min(aboutToDropDots+1, 100); PRINTX("dots:", aboutToDropDots); } 
-  EVERY_N_MILLISECONDS(500) { aboutToDropBPM += 1; PRINTX("bpm", aboutToDropBPM);}
-  
-  return juggle(aboutToDropDots, aboutToDropBPM);
-}
+  public:
 
-uint8_t dropped(uint8_t a, uint8_t b) {
-  discostrobe(120, 2); 
-  return NO_DELAY;
-}
+    AboutToDrop() : _rampTimer(500) {}
+
+    void init(const FrameContext&) {
+      _bpm = 1;
+      _dots = 30;
+      _rampTimer.reset();
+    }
+
+    uint8_t render(const FrameContext&) {
+
+      // increase BPM
+      if (_rampTimer) {
+        _dots = min(_dots + 1, 100);
+        _bpm += 1;
+        PRINTX("dots:", _dots);
+        PRINTX("bpm", _bpm);
+      }
+      
+      return juggle(_dots, _bpm);
+    }
+
+  private:
+
+    CEveryNMillis _rampTimer;
+    uint8_t _bpm;
+    uint8_t _dots;
+};
+
+class Dropped : public DiscoStrobe {
+
+  public:
+
+    uint8_t render(const FrameContext&) {
+      discostrobe(120, 2); 
+      return NO_DELAY;
+    }
+};
 
 
 // animation routine wrapper 
-uint8_t testPalette(uint8_t secondsPerPalette = 1, uint8_t gradientPalette = 0) { 
-  
-  static int gradientPaletteIndex = 0; 
-  EVERY_N_SECONDS(secondsPerPalette) { 
+// @param arg1  seconds per palette (1)
+// @param arg2  also step through the gradient palettes (0)
+class TestPalette : public AnimationBase {
 
-#ifdef CPT
-    if (gradientPalette) { 
-      palettes.getGradientPalette(gradientPaletteIndex); 
-      gradientPaletteIndex = addmod8(gradientPaletteIndex, 1, palettes.getGradientPaletteCount());
+  public:
+
+    void init(const FrameContext& ctx) {
+      _gradientPaletteIndex = 0;
+      _lastPalette = ctx.mNow;
     }
+
+    uint8_t render(const FrameContext& ctx) { 
+      
+      if (ctx.mNow - _lastPalette >= ctx.mArg1 * 1000UL) { 
+        _lastPalette = ctx.mNow;
+
+#ifdef CPT
+        if (ctx.mArg2) { 
+          palettes.getGradientPalette(_gradientPaletteIndex); 
+          _gradientPaletteIndex = addmod8(_gradientPaletteIndex, 1, palettes.getGradientPaletteCount());
+        }
 #endif
 
-    palettes.testPalette(leds, NUM_LEDS);
-    PRINT("Next palette");
-    palettes.moveToNextPalette();
-  }
+        palettes.testPalette(leds, NUM_LEDS);
+        PRINT("Next palette");
+        palettes.moveToNextPalette();
+      }
+
+      return STATIC_DELAY; 
+    }
+
+  private:
+
+    int _gradientPaletteIndex;
+    uint32_t _lastPalette;
+};
 
-  return STATIC_DELAY; 
-}
 
+/*
+   Layers
+*/
+
+// Brightness mask pulsing to a BPM, white keeps the pixels below it.
+// Cycles through 4 ways of pulsing every 10 seconds.
+// @param arg1  BPM (60)
+class BpmMask : public AnimationBase {
+
+  public:
+
+    BpmMask() : _stateTimer(10000) {}
+
+    void init(const FrameContext&) {
+      _state = 0;
+      _prevBeat = 0;
+      _stateTimer.reset();
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      const uint8_t numStates = 4;
+      uint8_t bpm = ctx.mArg1 ? ctx.mArg1 : 60;
+
+      if (_stateTimer) {
+        _state = addmod8(_state, 1, numStates);
+        PRINTX("BPM - Moving to state", _state);
+      }
+
+      uint8_t x = 0;
+      fill_solid(leds, NUM_LEDS, CRGB::White);
+
+      if (_state == 0) { 
+        x = beat8(bpm); 
+        fill_solid(leds, NUM_LEDS, CRGB(x, x, x));
+      } else if (_state == 1) { 
+        x = beatsin8(bpm); 
+        fill_solid(leds, NUM_LEDS, CRGB(x, x, x));
+      } else if (_state == 2) { 
+        x = beat8(bpm); 
+
+        if (x < _prevBeat) { 
+          // beat lowering
+          fill_solid(leds, NUM_LEDS, CRGB(x, x, x));
+        }    
+      } else if (_state == 3) { 
+        x = beat8(bpm);
+        // Alternatively turn off the first 2 rings then the large ring
+        if (x < _prevBeat) { 
+          fill_solid(leds, 40, CRGB(x, x, x));
+        }  else { 
+          // rising
+          fill_solid(&leds[40], NUM_LEDS - 40, CRGB(x, x, x));
+        }
+      }
+
+      _prevBeat = x;
+
+      /*
+      Try to play with the two rings, when going down use the center rings then up use the outer ring 
+
+      or even with the colors: hue = map8( sin8( myValue), HUE_BLUE, HUE_RED);
+      */
+
+      return NO_DELAY;
+    }
 
+  private:
 
+    CEveryNMillis _stateTimer;
+    uint8_t _state;
+    uint8_t _prevBeat;
+};
@@ -0,0 +1,214 @@
+#ifndef COMPOSITOR
+#define COMPOSITOR
+
+#include <FastLED.h>
+
+/**
+   Layers drawn over the current animation.
+
+   Every layer is an animation with its own state slot and pixel buffer.
+   The pixel buffers come from the scratch arena while the layered pattern
+   is on. The layers render one after the other, then a single pass over
+   the pixels blends all of them into leds.
+*/
+
+// Including the base animation
+#define MAX_LAYERS 4
+
+#define LAYER_ADD     0  // saturating add
+#define LAYER_MAX     1  // brightest channel wins
+#define LAYER_SCREEN  2  // 1 - (1 - a)(1 - b), brightens without clipping as hard as add
+#define LAYER_ALPHA   3  // layer over the frame at mAlpha opacity
+#define LAYER_MASK    4  // frame scaled by the layer, white keeps, black hides
+
+// Declared in Animations.h for AnimationPattern
+struct LayerPattern {
+  AnimationFactory mFactory;
+  uint8_t mArg1;
+  uint8_t mArg2;
+  uint8_t mBlend;
+  uint8_t mAlpha;      // LAYER_ALPHA only
+};
+
+typedef struct {
+  AnimationBase* mAnimation;
+  FrameContext mCtx;
+  uint8_t mBlend;
+  uint8_t mAlpha;
+  uint32_t mRenderTime;
+  uint32_t mSlot[(ANIMATION_SLOT_SIZE + 3) / 4];
+  CRGB* mLeds;  // LAYER_FRAME_SIZE bytes of scratch memory
+} Layer;
+
+// Same size as leds, animations write leds[NUM_LEDS]
+#define LAYER_FRAME_SIZE ((STRIP_SIZE + 1) * sizeof(CRGB))
+
+class Compositor {
+
+  public:
+
+    Compositor() : _layerCount(0), _compositeTime(0), _maxCompositeTime(0) {}
+
+    // Replaces the layers, NULL or 0 layers for none
+    void start(const LayerPattern* layers, uint8_t layerCount, const FrameContext& ctx) {
+      stop();
+
+      layerCount = min(layerCount, MAX_LAYERS - 1);
+
+      for (uint8_t l = 0; l < layerCount; l++) {
+        Layer& layer = _layers[_layerCount];
+
+        layer.mCtx.mArg1 = layers[l].mArg1;
+        layer.mCtx.mArg2 = layers[l].mArg2;
+        layer.mCtx.mNow = ctx.mNow;
+        layer.mBlend = layers[l].mBlend;
+        layer.mAlpha = layers[l].mAlpha;
+        layer.mRenderTime = 0;
+
+        arena.beginOwner(ownerOf(_layerCount));
+        layer.mLeds = (CRGB*)arena.alloc(LAYER_FRAME_SIZE);
+        layer.mAnimation = NULL;
+
+        if (layer.mLeds) {
+          fill_solid(layer.mLeds, STRIP_SIZE + 1, CRGB::Black);
+
+          CRGB* frame = leds;
+          leds = layer.mLeds;
+          layer.mAnimation = layers[l].mFactory(layer.mSlot);
+          layer.mAnimation->init(layer.mCtx);
+          leds = frame;
+        }
+
+        // A layer that doesn't get its scratch memory is left out
+        if (!arena.endOwner()) {
+          PRINTX("Not enough scratch memory for layer", l);
+          if (layer.mAnimation) layer.mAnimation->~AnimationBase();
+          arena.release(ownerOf(_layerCount));
+          continue;
+        }
+        _layerCount++;
+      }
+
+      _maxCompositeTime = 0;
+    }
+
+    void stop() {
+      for (uint8_t l = 0; l < _layerCount; l++) {
+        _layers[l].mAnimation->~AnimationBase();
+        arena.release(ownerOf(l));
+      }
+      _layerCount = 0;
+    }
+
+    // Renders the layers and blends them into leds
+    void render(uint32_t now) {
+      if (_layerCount == 0) return;
+
+      CRGB* frame = leds;
+
+      for (uint8_t l = 0; l < _layerCount; l++) {
+        Layer& layer = _layers[l];
+        uint32_t stageStart = micros();
+
+        leds = layer.mLeds;
+        layer.mCtx.mNow = now;
+        layer.mAnimation->render(layer.mCtx);
+
+        layer.mRenderTime = micros() - stageStart;
+      }
+
+      leds = frame;
+
+      uint32_t stageStart = micros();
+      composite();
+      _compositeTime = micros() - stageStart;
+      if (_compositeTime > _maxCompositeTime) _maxCompositeTime = _compositeTime;
+    }
+
+    uint8_t getLayerCount() { return _layerCount; }
+
+    // Time of the last blend pass over all the layers, in us
+    uint32_t getCompositeTime() { return _compositeTime; }
+
+    // Render and blend time the layers added to the last frame, in us
+    uint32_t getTotalTime() {
+      uint32_t total = _compositeTime;
+      for (uint8_t l = 0; l < _layerCount; l++) total += _layers[l].mRenderTime;
+      return total;
+    }
+
+    // RAM of every layer and per layer render time
+    void dump() {
+      Serial.print("Layers: ");
+      Serial.print(_layerCount);
+      Serial.print("/");
+      Serial.print(MAX_LAYERS - 1);
+      Serial.print(" || RAM per layer (bytes): ");
+      Serial.print(sizeof(Layer));
+      Serial.print(" + ");
+      Serial.print(LAYER_FRAME_SIZE);
+      Serial.print(" scratch || Total RAM: ");
+      Serial.println(sizeof(_layers));
+
+      for (uint8_t l = 0; l < _layerCount; l++) {
+        Serial.print("layer ");
+        Serial.print(l);
+        Serial.print(" mode ");
+        Serial.print(_layers[l].mBlend);
+        Serial.print(" render (us): ");
+        Serial.println(_layers[l].mRenderTime);
+      }
+
+      Serial.print("Composite (us): ");
+      Serial.print(_compositeTime);
+      Serial.print(" max ");
+      Serial.println(_maxCompositeTime);
+    }
+
+  private:
+
+    // Arena owners after the animation slots
+    uint8_t ownerOf(uint8_t layer) { return ANIMATION_SLOTS + layer; }
+
+    // One pass over the pixels, every layer blended in turn
+    void composite() {
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        CRGB pixel = leds[i];
+
+        for (uint8_t l = 0; l < _layerCount; l++) {
+          const CRGB& src = _layers[l].mLeds[i];
+
+          switch (_layers[l].mBlend) {
+            case LAYER_ADD:
+              pixel += src;
+              break;
+            case LAYER_MAX:
+              pixel |= src;
+              break;
+            case LAYER_SCREEN:
+              pixel.r = 255 - scale8(255 - pixel.r, 255 - src.r);
+              pixel.g = 255 - scale8(255 - pixel.g, 255 - src.g);
+              pixel.b = 255 - scale8(255 - pixel.b, 255 - src.b);
+              break;
+            case LAYER_ALPHA:
+              nblend(pixel, src, _layers[l].mAlpha);
+              break;
+            case LAYER_MASK:
+              pixel.r = scale8_video(pixel.r, src.r);
+              pixel.g = scale8_video(pixel.g, src.g);
+              pixel.b = scale8_video(pixel.b, src.b);
+              break;
+          }
+        }
+
+        leds[i] = pixel;
+      }
+    }
+
+    Layer _layers[MAX_LAYERS - 1];
+    uint8_t _layerCount;
+    uint32_t _compositeTime;
+    uint32_t _maxCompositeTime;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+   Outer-totalistic automata on the LEDs themselves.
+
+   Every LED is a cell and its neighbours are its LED_NEIGHBOURS nearest
+   LEDs from ledNeighbours, so all the cells that are simulated are seen,
+   unlike Life's 32x32 board where 100 of 1024 cells have a LED.
+   The neighbour graph isn't symmetric, an LED on the rim counts inner
+   LEDs that don't count it back.
+
+   @param arg1  birth mask, bit n set: a dead cell with n live neighbours is born
+   @param arg2  survival mask, bit n set: a live cell with n live neighbours lives on
+*/
+
+// Rule masks for a number of live neighbours
+#define NEIGHBOURS(n) (1 << (n))
+
+#define AUTOMATON_DENSITY          30  // % of cells alive when seeded
+#define AUTOMATON_MAX_GENERATIONS 200
+
+#define AUTOMATON_WORDS ((NUM_LEDS + 31) / 32)
+
+typedef struct {
+  uint8_t mHue[NUM_LEDS];
+  uint8_t mBrightness[NUM_LEDS];
+  BoardHistory mHistory;
+} AutomatonColors;
+
+class LedAutomaton : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext&) {
+      // render() and randomFill() don't check _colors: when it can't be
+      // had, AnimationSlots::start() puts a palette fill in our place
+      _colors = (AutomatonColors*)arena.alloc(sizeof(AutomatonColors));
+      if (!_colors) return;
+
+      randomFill();
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      uint8_t birth = ctx.mArg1;
+      uint8_t survival = ctx.mArg2;
+
+      uint32_t next[AUTOMATON_WORDS];
+      memset(next, 0, sizeof(next));
+      uint8_t liveCells = 0;
+
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        leds[i] = palettes.colorAt(_colors->mHue[i] * 4, _colors->mBrightness[i]);
+
+        const uint8_t* neighbours = &ledNeighbours.mLeds[i * LED_NEIGHBOURS];
+        uint8_t count = 0;
+        for (uint8_t n = 0; n < LED_NEIGHBOURS; n++) {
+          count += isAlive(_cells, neighbours[n]);
+        }
+
+        bool alive = isAlive(_cells, i);
+        if (((alive ? survival : birth) >> count) & 1) {
+          next[i / 32] |= 1UL << (i % 32);
+          liveCells++;
+        }
+
+        if (alive) continue;
+
+        // Dead cells fade out, new ones light up
+        _colors->mBrightness[i] >>= 1;
+
+        if (isAlive(next, i)) {
+          _colors->mHue[i] += 2;
+          _colors->mBrightness[i] = 255;
+        }
+      }
+
+      memcpy(_cells, next, sizeof(_cells));
+
+      if (liveCells < 3 || _generation >= AUTOMATON_MAX_GENERATIONS ||
+          _colors->mHistory.seenBefore(_cells, AUTOMATON_WORDS)) {
+        randomFill();
+      } else {
+        _generation++;
+      }
+
+      return SYNCED_DELAY;
+    }
+
+  private:
+
+    static bool isAlive(const uint32_t* cells, uint8_t i) {
+      return (cells[i / 32] >> (i % 32)) & 1;
+    }
+
+    void randomFill() {
+      memset(_cells, 0, sizeof(_cells));
+
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        bool alive = random8(100) < AUTOMATON_DENSITY;
+        if (alive) _cells[i / 32] |= 1UL << (i % 32);
+        _colors->mHue[i] = 0;
+        _colors->mBrightness[i] = alive ? 255 : 0;
+      }
+
+      _colors->mHistory.clear();
+      _generation = 0;
+    }
+
+    uint32_t _cells[AUTOMATON_WORDS];
+    uint8_t _generation;
+    AutomatonColors* _colors;
+};
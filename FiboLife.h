@@ -16,324 +16,354 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-class Cell {
-  public:
-    byte alive = 1;
-    byte prev = 1;
-    byte hue = 6;
-    byte brightness;
-};
+// Boards seen in the last generations, a repeat is a still life or an oscillator
+#define BOARD_HISTORY 16
 
-Cell world[kMatrixWidth][kMatrixHeight];
-
-uint8_t neighbors(uint8_t x, uint8_t y) {
-  return (world[(x + 1) % kMatrixWidth][y].prev) +
-         (world[x][(y + 1) % kMatrixHeight].prev) +
-         (world[(x + kMatrixWidth - 1) % kMatrixWidth][y].prev) +
-         (world[x][(y + kMatrixHeight - 1) % kMatrixHeight].prev) +
-         (world[(x + 1) % kMatrixWidth][(y + 1) % kMatrixHeight].prev) +
-         (world[(x + kMatrixWidth - 1) % kMatrixWidth][(y + 1) % kMatrixHeight].prev) +
-         (world[(x + kMatrixWidth - 1) % kMatrixWidth][(y + kMatrixHeight - 1) % kMatrixHeight].prev) +
-         (world[(x + 1) % kMatrixWidth][(y + kMatrixHeight - 1) % kMatrixHeight].prev);
-}
+class BoardHistory {
+
+  public:
 
-void randomFillWorld() {
-  static uint8_t lifeDensity = 10;
+    void clear() {
+      memset(_hashes, 0, sizeof(_hashes));
+      _next = 0;
+    }
 
-  for (uint8_t i = 0; i < kMatrixWidth; i++) {
-    for (uint8_t j = 0; j < kMatrixHeight; j++) {
-      if (random(100) < lifeDensity) {
-        world[i][j].alive = 1;
-        world[i][j].brightness = 255;
+    // Remembers the board, true if it was there in the last generations
+    bool seenBefore(const uint32_t* words, uint8_t count) {
+      uint32_t hash = 2166136261UL;
+      for (uint8_t w = 0; w < count; w++) {
+        hash = (hash ^ words[w]) * 16777619UL;
       }
-      else {
-        world[i][j].alive = 0;
-        world[i][j].brightness = 0;
+
+      for (uint8_t h = 0; h < BOARD_HISTORY; h++) {
+        if (_hashes[h] == hash) return true;
       }
-      world[i][j].prev = world[i][j].alive;
-      world[i][j].hue = 0;
+
+      _hashes[_next] = hash;
+      _next = (_next + 1) % BOARD_HISTORY;
+      return false;
     }
-  }
-}
 
-uint8_t life() {
-  static uint8_t generation = 0;
+  private:
 
-  // Display current generation
-  for (uint8_t i = 0; i < kMatrixWidth; i++)
-  {
-    for (uint8_t j = 0; j < kMatrixHeight; j++)
-    {
-      setPixelXY(i, j, ColorFromPalette(palettes.getPalette(), world[i][j].hue * 4, world[i][j].brightness, LINEARBLEND));
-    }
-  }
+    uint32_t _hashes[BOARD_HISTORY];
+    uint8_t _next;
+};
 
-  uint8_t liveCells = 0;
+// One bit per cell, bit x of row y, so the board wraps around with rotations
+static_assert(kMatrixWidth == 32, "Life rows are 32 bit words");
 
-  // Birth and death cycle
-  for (uint8_t x = 0; x < kMatrixWidth; x++)
-  {
-    for (uint8_t y = 0; y < kMatrixHeight; y++)
-    {
-      // Default is for cell to stay the same
-      if (world[x][y].brightness > 0 && world[x][y].prev == 0)
-        world[x][y].brightness *= 0.5;
+// Colors are only kept for the cells that have a LED
+typedef struct {
+  uint32_t mRows[kMatrixHeight];
+  uint8_t mHue[NUM_LEDS];
+  uint8_t mBrightness[NUM_LEDS];
+  BoardHistory mHistory;
+} LifeWorld;
 
-      uint8_t count = neighbors(x, y);
+// The world lives in the scratch arena while Life is on
+class Life : public AnimationBase {
 
-      if (count == 3 && world[x][y].prev == 0)
-      {
-        // A new cell is born
-        world[x][y].alive = 1;
-        world[x][y].hue += 2;
-        world[x][y].brightness = 255;
-      }
-      else if ((count < 2 || count > 3) && world[x][y].prev == 1)
-      {
-        // Cell dies
-        world[x][y].alive = 0;
-      }
+  public:
 
-      if (world[x][y].alive)
-        liveCells++;
-    }
-  }
+    void init(const FrameContext&) {
+      _world = (LifeWorld*)arena.alloc(sizeof(LifeWorld));
+      if (!_world) return;
 
-  // Copy next generation into place
-  for (uint8_t x = 0; x < kMatrixWidth; x++)
-  {
-    for (uint8_t y = 0; y < kMatrixHeight; y++)
-    {
-      world[x][y].prev = world[x][y].alive;
+      randomFillWorld();
     }
-  }
 
-  if (liveCells < 4 || generation >= 128)
-  {
-    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    // way too fast
+    uint8_t render(const FrameContext&) {
+      // Display current generation
+      for (uint8_t i = 0; i < NUM_LEDS; i++)
+      {
+        leds[i] = palettes.colorAt(_world->mHue[i] * 4, _world->mBrightness[i]);
+      }
 
-    randomFillWorld();
+      // Birth and death cycle
+      uint32_t next[kMatrixHeight];
+      uint16_t liveCells = 0;
 
-    generation = 0;
-  }
-  else
-  {
-    generation++;
-  }
+      for (uint8_t y = 0; y < kMatrixHeight; y++)
+      {
+        next[y] = nextRow(y);
+        liveCells += __builtin_popcount(next[y]);
+      }
 
-  return 60;
-}
+      for (uint8_t i = 0; i < NUM_LEDS; i++)
+      {
+        uint8_t x = coordsX32[physicalToFibonacciOrder[i]];
+        uint8_t y = coordsY32[physicalToFibonacciOrder[i]];
+        uint32_t bit = 1UL << x;
+
+        if (_world->mRows[y] & bit) continue;
 
-void heatMap(CRGBPalette16 palette, bool up)
-{
-  fill_solid(leds, NUM_LEDS, CRGB::Black);
+        // Default is for cell to stay the same
+        _world->mBrightness[i] >>= 1;
 
-  // Add entropy to random number generator; we use a lot of it.
-  random16_add_entropy(random(256));
+        if (next[y] & bit)
+        {
+          // A new cell is born
+          _world->mHue[i] += 2;
+          _world->mBrightness[i] = 255;
+        }
+      }
 
-  // COOLING: How much does the air cool as it rises?
-  // Less cooling = taller flames.  More cooling = shorter flames.
-  // Default 55, suggested range 20-100
-  uint8_t cooling = 55;
+      // Copy next generation into place
+      memcpy(_world->mRows, next, sizeof(next));
 
-  // SPARKING: What chance (out of 255) is there that a new spark will be lit?
-  // Higher chance = more roaring fire.  Lower chance = more flickery fire.
-  // Default 120, suggested range 50-200.
-  uint8_t sparking = 120;
+      if (liveCells < 4 || _generation >= 128 || _world->mHistory.seenBefore(_world->mRows, kMatrixHeight))
+      {
+        fill_solid(leds, NUM_LEDS, CRGB::Black);
 
-  // Array of temperature readings at each simulation cell
-  static byte heat[kMatrixWidth + 3][kMatrixHeight + 3];
+        randomFillWorld();
+      }
+      else
+      {
+        _generation++;
+      }
 
-  for (int x = 0; x < 10; x++)
-  {
-    // Step 1.  Cool down every cell a little
-    for (int y = 0; y < 10; y++)
-    {
-      heat[x][y] = qsub8(heat[x][y], random8(0, ((cooling * 10) / kMatrixHeight) + 2));
+      return 60;
     }
 
-    // Step 2.  Heat from each cell drifts 'up' and diffuses a little
-    for (int y = 0; y < kMatrixHeight; y++)
-    {
-      heat[x][y] = (heat[x][y + 1] + heat[x][y + 2] + heat[x][y + 2]) / 3;
+  private:
+
+    // Rules applied to 32 cells at once with bit-sliced adders: the
+    // neighbour count of every cell is summed in parallel, one bit plane
+    // per binary digit
+    uint32_t nextRow(uint8_t y) {
+      uint32_t above = _world->mRows[(y + kMatrixHeight - 1) % kMatrixHeight];
+      uint32_t row = _world->mRows[y];
+      uint32_t below = _world->mRows[(y + 1) % kMatrixHeight];
+
+      // Above and below: left, center and right, 0-3
+      uint32_t a0, a1, b0, b1;
+      addThree(rotateLeft(above), above, rotateRight(above), a0, a1);
+      addThree(rotateLeft(below), below, rotateRight(below), b0, b1);
+
+      // Same row: left and right, 0-2
+      uint32_t c0 = rotateLeft(row) ^ rotateRight(row);
+      uint32_t c1 = rotateLeft(row) & rotateRight(row);
+
+      // Ones of the total and the carry into the twos
+      uint32_t s0, k0;
+      addThree(a0, b0, c0, s0, k0);
+
+      // Twos of the total, and whether it reached 4
+      uint32_t p = a1 ^ b1;
+      uint32_t q = c1 ^ k0;
+      uint32_t s1 = p ^ q;
+      uint32_t four = (a1 & b1) | (c1 & k0) | (p & q);
+
+      // 3 neighbours, or 2 and alive
+      return s1 & ~four & (s0 | row);
     }
 
-    // Step 2.  Randomly ignite new 'sparks' of heat
-    if (random8() < sparking)
-    {
-      heat[x][maxY] = qadd8(heat[x][maxY], random8(160, 255));
+    static void addThree(uint32_t a, uint32_t b, uint32_t c, uint32_t& sum, uint32_t& carry) {
+      uint32_t t = a ^ b;
+      sum = t ^ c;
+      carry = (a & b) | (t & c);
     }
 
-    // Step 4.  Map from heat cells to LED colors
-    for (int y = 0; y < kMatrixHeight; y++)
-    {
-      uint8_t colorIndex = 0;
+    // Every cell gets its neighbour at x - 1 (left) or x + 1 (right), wrapping around
+    static uint32_t rotateLeft(uint32_t row)  { return (row << 1) | (row >> 31); }
+    static uint32_t rotateRight(uint32_t row) { return (row >> 1) | (row << 31); }
 
-      if (up)
-        colorIndex = heat[x][y];
-      else
-        colorIndex = heat[x][(maxY) - y];
+    void randomFillWorld() {
+      const uint8_t lifeDensity = 10;
 
-      // Recommend that you use values 0-240 rather than
-      // the usual 0-255, as the last 15 colors will be
-      // 'wrapping around' from the hot end to the cold end,
-      // which looks wrong.
-      colorIndex = scale8(colorIndex, 240);
+      for (uint8_t y = 0; y < kMatrixHeight; y++) {
+        _world->mRows[y] = 0;
+        for (uint8_t x = 0; x < kMatrixWidth; x++) {
+          if (random(100) < lifeDensity) _world->mRows[y] |= 1UL << x;
+        }
+      }
 
-      // override color 0 to ensure a black background
-      if (colorIndex != 0)
-      {
-        setPixelXY10(x, y, ColorFromPalette(palette, colorIndex, 255, LINEARBLEND));
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        uint8_t x = coordsX32[physicalToFibonacciOrder[i]];
+        uint8_t y = coordsY32[physicalToFibonacciOrder[i]];
+        _world->mHue[i] = 0;
+        _world->mBrightness[i] = (_world->mRows[y] >> x) & 1 ? 255 : 0;
       }
+
+      _world->mHistory.clear();
+      _generation = 0;
     }
-  }
-}
 
-uint8_t fire() {
-  heatMap(HeatColors_p, true);
+    LifeWorld* _world;
+    uint8_t _generation;
+};
 
-  return 30;
-}
+class Wave : public AnimationBase {
 
-uint8_t wave() {
-  const uint8_t scale = 256 / kMatrixWidth;
+  public:
 
-  static uint8_t rotation = 0;
-  static uint8_t theta = 0;
-  static uint8_t waveCount = 1;
+    Wave() : _rotationTimer(10000), _thetaTimer(7) {}
 
-  uint8_t n = 0;
+    void init(const FrameContext&) {
+      _rotation = 0;
+      _theta = 0;
+      _waveCount = 1;
+      _rotationTimer.reset();
+      _thetaTimer.reset();
+    }
 
-  CRGBPalette16 currentPalette = palettes.getPalette();
-  
-  switch (rotation) {
-    case 0:
-      for (int x = 0; x < kMatrixWidth; x++) {
-        n = quadwave8(x * 2 + theta) / scale;
-        setPixelXY(x, n, ColorFromPalette(currentPalette, x + gHue, 255, LINEARBLEND));
-        if (waveCount == 2)
-          setPixelXY(x, maxY - n, ColorFromPalette(currentPalette, x + gHue, 255, LINEARBLEND));
-      }
-      break;
-
-    case 1:
-      for (int y = 0; y < kMatrixHeight; y++) {
-        n = quadwave8(y * 2 + theta) / scale;
-        setPixelXY(n, y, ColorFromPalette(currentPalette, y + gHue, 255, LINEARBLEND));
-        if (waveCount == 2)
-          setPixelXY(maxX - n, y, ColorFromPalette(currentPalette, y + gHue, 255, LINEARBLEND));
-      }
-      break;
-
-    case 2:
-      for (int x = 0; x < kMatrixWidth; x++) {
-        n = quadwave8(x * 2 - theta) / scale;
-        setPixelXY(x, n, ColorFromPalette(currentPalette, x + gHue));
-        if (waveCount == 2)
-          setPixelXY(x, maxY - n, ColorFromPalette(currentPalette, x + gHue, 255, LINEARBLEND));
+    // TODO Should got a bit slower // Try different delays
+    uint8_t render(const FrameContext&) {
+      const uint8_t scale = 256 / kMatrixWidth;
+
+      uint8_t n = 0;
+
+      switch (_rotation) {
+        case 0:
+          for (int x = 0; x < kMatrixWidth; x++) {
+            n = quadwave8(x * 2 + _theta) / scale;
+            setPixelXY(x, n, palettes.colorAt(x + gHue));
+            if (_waveCount == 2)
+              setPixelXY(x, maxY - n, palettes.colorAt(x + gHue));
+          }
+          break;
+
+        case 1:
+          for (int y = 0; y < kMatrixHeight; y++) {
+            n = quadwave8(y * 2 + _theta) / scale;
+            setPixelXY(n, y, palettes.colorAt(y + gHue));
+            if (_waveCount == 2)
+              setPixelXY(maxX - n, y, palettes.colorAt(y + gHue));
+          }
+          break;
+
+        case 2:
+          for (int x = 0; x < kMatrixWidth; x++) {
+            n = quadwave8(x * 2 - _theta) / scale;
+            setPixelXY(x, n, palettes.colorAt(x + gHue));
+            if (_waveCount == 2)
+              setPixelXY(x, maxY - n, palettes.colorAt(x + gHue));
+          }
+          break;
+
+        case 3:
+          for (int y = 0; y < kMatrixHeight; y++) {
+            n = quadwave8(y * 2 - _theta) / scale;
+            setPixelXY(n, y, palettes.colorAt(y + gHue));
+            if (_waveCount == 2)
+              setPixelXY(maxX - n, y, palettes.colorAt(y + gHue));
+          }
+          break;
       }
-      break;
-
-    case 3:
-      for (int y = 0; y < kMatrixHeight; y++) {
-        n = quadwave8(y * 2 - theta) / scale;
-        setPixelXY(n, y, ColorFromPalette(currentPalette, y + gHue, 255, LINEARBLEND));
-        if (waveCount == 2)
-          setPixelXY(maxX - n, y, ColorFromPalette(currentPalette, y + gHue, 255, LINEARBLEND));
+
+      dimAll(255);
+
+      if (_rotationTimer)
+      {
+        _rotation = random(0, 4);
+        // _waveCount = random(1, 3);
+      };
+
+      if (_thetaTimer) {
+        _theta++;
       }
-      break;
-  }
 
-  dimAll(255);
+      return 8;
+    }
 
-  EVERY_N_SECONDS(10)
-  {
-    rotation = random(0, 4);
-    // waveCount = random(1, 3);
-  };
+  private:
 
-  EVERY_N_MILLISECONDS(7) {
-    theta++;
-  }
+    CEveryNMillis _rotationTimer;
+    CEveryNMillis _thetaTimer;
+    uint8_t _rotation;
+    uint8_t _theta;
+    uint8_t _waveCount;
+};
 
-  return 8;
-}
 
 
+#define PULSE_MAX_STEPS 16
 
-uint8_t pulse() {
-  dimAll(200);
+// 255 * 0.8^(step - 2), truncated like the float version, capped at 255
+const uint8_t PULSE_FADE[PULSE_MAX_STEPS] = {
+  255, 255, 255, 204, 163, 130, 104, 83, 66, 53, 42, 34, 27, 21, 17, 14
+};
 
-  uint8_t maxSteps = 16;
-  static uint8_t step = maxSteps;
-  static uint8_t centerX = 0;
-  static uint8_t centerY = 0;
-  float fadeRate = 0.8;
+// Rings on the 256x256 coordinates, 8 units per step like a cell of the 32x32 grid
+#define PULSE_STEP_RADIUS  8
+#define PULSE_RING_WIDTH  12
 
-  if (step >= maxSteps)
-  {
-    centerX = random(kMatrixWidth);
-    centerY = random(kMatrixWidth);
-    step = 0;
-  }
+class Pulse : public AnimationBase {
 
-  if (step == 0)
-  {
-    drawCircle(centerX, centerY, step, ColorFromPalette(palettes.getPalette(), gHue, 255, LINEARBLEND));
-    step++;
-  }
-  else
-  {
-    if (step < maxSteps)
-    {
-      // initial pulse
-      drawCircle(centerX, centerY, step, ColorFromPalette(palettes.getPalette(), gHue, pow(fadeRate, step - 2) * 255, LINEARBLEND));
-
-      // secondary pulse
-      if (step > 3) {
-        drawCircle(centerX, centerY, step - 3, ColorFromPalette(palettes.getPalette(), gHue, pow(fadeRate, step - 2) * 255, LINEARBLEND));
-      }
+  public:
 
-      step++;
+    void init(const FrameContext&) {
+      _step = PULSE_MAX_STEPS;
+      _centerX = 0;
+      _centerY = 0;
     }
-    else
-    {
-      step = -1;
+
+    uint8_t render(const FrameContext&) {
+      dimAll(200);
+
+      uint8_t maxSteps = PULSE_MAX_STEPS;
+
+      if (_step >= maxSteps)
+      {
+        _centerX = random8();
+        _centerY = random8();
+        _step = 0;
+      }
+
+      if (_step == 0)
+      {
+        drawDisc(_centerX, _centerY, 0, PULSE_RING_WIDTH, palettes.colorAt(gHue));
+        _step++;
+      }
+      else
+      {
+        if (_step < maxSteps)
+        {
+          // initial pulse
+          drawRing(_centerX, _centerY, _step * PULSE_STEP_RADIUS, PULSE_RING_WIDTH, palettes.colorAt(gHue, PULSE_FADE[_step]));
+
+          // secondary pulse
+          if (_step > 3) {
+            drawRing(_centerX, _centerY, (_step - 3) * PULSE_STEP_RADIUS, PULSE_RING_WIDTH, palettes.colorAt(gHue, PULSE_FADE[_step]));
+          }
+
+          _step++;
+        }
+        else
+        {
+          _step = -1;
+        }
+      }
+
+      return 30 * 4;
     }
-  }
 
-  return 30;
-}
+  private:
 
+    uint8_t _step;
+    uint8_t _centerX;
+    uint8_t _centerY;
+};
 
 
-// ColorWavesWithPalettes by Mark Kriegsman: https://gist.github.com/kriegsman/8281905786e8b2632aeb
-// This function draws color waves with an ever-changing,
-// widely-varying set of parameters, using a color palette.
-void colorwaves( CRGB* ledarray, uint16_t numleds, CRGBPalette16& palette, bool useFibonacciOrder)
-{
-  static uint16_t sPseudotime = 0;
-  static uint16_t sLastMillis = 0;
-  static uint16_t sHue16 = 0;
-
-  // uint8_t sat8 = beatsin88( 87, 220, 250);
-  uint8_t brightdepth = beatsin88( 341, 96, 224);
-  uint16_t brightnessthetainc16 = beatsin88( 203, (25 * 256), (40 * 256));
-  uint8_t msmultiplier = beatsin88(147, 23, 60);
-
-  uint16_t hue16 = sHue16;//gHue * 256;
-  uint16_t hueinc16 = beatsin88(113, 300, 1500);
-
-  uint16_t ms = millis();
-  uint16_t deltams = ms - sLastMillis ;
-  sLastMillis  = ms;
-  sPseudotime += deltams * msmultiplier;
-  sHue16 += deltams * beatsin88( 400, 5, 9);
-  uint16_t brightnesstheta16 = sPseudotime;
-
-  for ( uint16_t i = 0 ; i < numleds; i++) {
-    hue16 += hueinc16;
-    uint8_t hue8 = hue16 / 256;
+
+// One color wave step per LED, in the Fibonacci order or around the center
+struct ColorWave {
+  uint16_t mHue16;
+  uint16_t mHueInc16;
+  uint16_t mBrightnessTheta16;
+  uint16_t mBrightnessThetaInc16;
+  uint8_t mBrightDepth;
+  bool mFibonacciOrder;
+
+  CRGB operator()(uint8_t /* x */, uint8_t /* y */, uint8_t angle, uint8_t /* radius */, uint8_t fibIndex, uint32_t /* t */) const {
+    // Steps taken by the wave to get to this LED
+    uint16_t step = (mFibonacciOrder ? (NUM_LEDS - 1) - fibIndex : scale8(angle, NUM_LEDS - 1)) + 1;
+
+    uint16_t hue16 = mHue16 + step * mHueInc16;
+    uint8_t hue8;
     uint16_t h16_128 = hue16 >> 7;
     if ( h16_128 & 0x100) {
       hue8 = 255 - (h16_128 >> 1);
@@ -341,116 +371,116 @@ void colorwaves( CRGB* ledarray, uint16_t numleds, CRGBPalette16& palette, bool
       hue8 = h16_128 >> 1;
     }
 
-    brightnesstheta16  += brightnessthetainc16;
-    uint16_t b16 = sin16( brightnesstheta16  ) + 32768;
+    uint16_t b16 = sin16( mBrightnessTheta16 + step * mBrightnessThetaInc16 ) + 32768;
 
     uint16_t bri16 = (uint32_t)((uint32_t)b16 * (uint32_t)b16) / 65536;
-    uint8_t bri8 = (uint32_t)(((uint32_t)bri16) * brightdepth) / 65536;
-    bri8 += (255 - brightdepth);
+    uint8_t bri8 = (uint32_t)(((uint32_t)bri16) * mBrightDepth) / 65536;
+    bri8 += (255 - mBrightDepth);
 
     uint8_t index = hue8;
     //index = triwave8( index);
     index = scale8( index, 240);
 
-    CRGB newcolor = ColorFromPalette( palette, index, bri8);
+    return palettes.gradientColorAt(index, bri8);
+  }
+};
 
-    uint16_t pixelnumber = i;
+// ColorWavesWithPalettes by Mark Kriegsman: https://gist.github.com/kriegsman/8281905786e8b2632aeb
+// This function draws color waves with an ever-changing,
+// widely-varying set of parameters, using a color palette.
+// @param arg1  1 waves along the Fibonacci order, 0 around the center
+class ColorWaves : public AnimationBase {
 
+  public:
 
-    if (useFibonacciOrder) {
-      pixelnumber = fibonacciToPhysicalOrder[(numleds - 1) - pixelnumber];
+    void init(const FrameContext& ctx) {
+      _pseudotime = 0;
+      _lastMillis = ctx.mNow;
+      _hue16 = 0;
     }
 
-    nblend( ledarray[pixelnumber], newcolor, 128);
-  }
-}
-
-uint8_t radialPaletteShift() {
-  for (uint8_t i = 0; i < NUM_LEDS; i++) {
-    // leds[i] = ColorFromPalette( currentPalette, gHue + sin8(i*16), brightness);
-    uint8_t index = fibonacciToPhysicalOrder[(NUM_LEDS - 1) - i];
+    uint8_t render(const FrameContext& ctx) {
+      // uint8_t sat8 = beatsin88( 87, 220, 250);
+      uint8_t brightdepth = beatsin88( 341, 96, 224);
+      uint16_t brightnessthetainc16 = beatsin88( 203, (25 * 256), (40 * 256));
+      uint8_t msmultiplier = beatsin88(147, 23, 60);
 
-    leds[index] = ColorFromPalette(palettes.getGradientPalette(), i + gHue, 255, LINEARBLEND);
-  }
+      uint16_t hue16 = _hue16;//gHue * 256;
+      uint16_t hueinc16 = beatsin88(113, 300, 1500);
 
-  return 8;
-}
+      uint16_t ms = ctx.mNow;
+      uint16_t deltams = ms - _lastMillis ;
+      _lastMillis  = ms;
+      _pseudotime += deltams * msmultiplier;
+      _hue16 += deltams * beatsin88( 400, 5, 9);
+      uint16_t brightnesstheta16 = _pseudotime;
 
-uint8_t incrementalDrift() {
-  uint8_t stepwidth = 256 * (20 - 1) / NUM_LEDS;
-  for (uint8_t i = 0; i < NUM_LEDS; i++) {
-    uint8_t bri = beatsin88(1 * 256 + (NUM_LEDS - i) * stepwidth, 0, 256);
-    leds[fibonacciToPhysicalOrder[i]] = ColorFromPalette(palettes.getGradientPalette(), 2.5 * i + gHue, bri, LINEARBLEND);
-  }
+      ColorWave shader = {hue16, hueinc16, brightnesstheta16, brightnessthetainc16,
+                          brightdepth, ctx.mArg1 ? true : false};
+      shadeOver(shader, ctx.mNow, 128);
 
-  return 8;
-}
+      return 20;
+    }
 
-CRGB scrollingVerticalWashColor( uint8_t x, uint8_t y, unsigned long timeInMillis)
-{
-  return CHSV( y + (timeInMillis / 10), 255, 255);
-}
+  private:
 
+    uint16_t _pseudotime;
+    uint16_t _lastMillis;
+    uint16_t _hue16;
+};
 
-uint8_t verticalRainbow()
-{
-  unsigned long t = millis();
+// The palette along the Fibonacci order, from the outside in
+struct RadialPaletteShift {
+  uint8_t mHue;
 
-  for (uint8_t i = 0; i < NUM_LEDS; i++) {
-    uint8_t j = physicalToFibonacciOrder[i];
-    leds[i] = scrollingVerticalWashColor(coordsX[j], coordsY[j], t);
+  CRGB operator()(uint8_t /* x */, uint8_t /* y */, uint8_t /* angle */, uint8_t /* radius */, uint8_t fibIndex, uint32_t /* t */) const {
+    return palettes.gradientColorAt(((NUM_LEDS - 1) - fibIndex) + mHue);
   }
+};
+
+uint8_t radialPaletteShift(uint8_t, uint8_t) {
+  RadialPaletteShift shader = {gHue};
+  shade(shader, millis());
 
   return 8;
 }
 
-/*
-    Animations ready for HeartLEDSuit
-*/
-CRGBPalette16 IceColors_p = CRGBPalette16(CRGB::Black, CRGB::Blue, CRGB::Aqua, CRGB::White);
+// Every LED breathes a little faster than the next one in the Fibonacci order
+#define DRIFT_STEP_WIDTH (256 * (20 - 1) / NUM_LEDS)
 
-uint8_t colorWaves(uint8_t useFibonacci, uint8_t dummy) {
-  CRGBPalette16 pal = palettes.getGradientPalette();
-  colorwaves(leds, NUM_LEDS, pal, useFibonacci ? true : false);
-  return 20;
-}
-
-// way too fast
-uint8_t life(uint8_t dummy, uint8_t dummy2) {
-  return life();
-}
+struct IncrementalDrift {
+  uint8_t mHue;
 
-uint8_t pulse(uint8_t dummy, uint8_t dummy2) { 
-  return pulse() * 4;
-}
+  CRGB operator()(uint8_t /* x */, uint8_t /* y */, uint8_t /* angle */, uint8_t /* radius */, uint8_t fibIndex, uint32_t t) const {
+    uint8_t bri = beatsin88At(t, 1 * 256 + (NUM_LEDS - fibIndex) * DRIFT_STEP_WIDTH, 0, 255);
+    // 2.5 palette steps per LED
+    return palettes.gradientColorAt(((fibIndex * 5) >> 1) + mHue, bri);
+  }
+};
 
-uint8_t wave(uint8_t dummy, uint8_t dummy2) { 
+uint8_t incrementalDrift(uint8_t, uint8_t) {
+  IncrementalDrift shader = {gHue};
+  shade(shader, millis());
 
-  // TODO Should got a bit slower // Try different delays
-  return wave(); 
+  return 8;
 }
 
-uint8_t incrementalDrift(uint8_t dummy, uint8_t dummy2) { 
-  return incrementalDrift();
-}
+struct ScrollingVerticalWash {
+  uint8_t mShift;
 
-uint8_t verticalRainbow(uint8_t dummy, uint8_t dummy2) { 
-  return verticalRainbow();
-}
+  CRGB operator()(uint8_t /* x */, uint8_t y, uint8_t /* angle */, uint8_t /* radius */, uint8_t /* fibIndex */, uint32_t /* t */) const {
+    return CHSV(y + mShift, 255, 255);
+  }
+};
 
-uint8_t radialPaletteShift(uint8_t dummy, uint8_t dummy2) { 
-  return radialPaletteShift();
-}
-uint8_t fiboFire(uint8_t dummy, uint8_t dummy2) { 
-  heatMap(HeatColors_p, true);  
-  return RANDOM_DELAY;
-}
+uint8_t verticalRainbow(uint8_t, uint8_t) {
+  ScrollingVerticalWash shader = {(uint8_t)(millis() / 10)};
+  shade(shader, millis());
 
-// Way too fast
-uint8_t water(uint8_t dummy, uint8_t dummy2) { 
-  heatMap(IceColors_p, false); 
-  return SYNCED_DELAY; 
+  return 8;
 }
 
-
-
+/*
+    Animations ready for HeartLEDSuit
+*/
+CRGBPalette16 IceColors_p = CRGBPalette16(CRGB::Black, CRGB::Blue, CRGB::Aqua, CRGB::White);
@@ -1,5 +1,5 @@
 
-uint8_t fibonacciToPhysicalOrder[100] = {
+constexpr uint8_t fibonacciToPhysicalOrder[100] = {
   99, 97, 98, 96, 92, 95, 91, 93, 89, 84,
   94, 90, 85, 88, 83, 86, 81, 76, 87, 82,
   77, 80, 75, 78, 73, 68, 79, 74, 69, 72,
@@ -12,7 +12,7 @@ uint8_t fibonacciToPhysicalOrder[100] = {
   12,  4,  9,  1,  6, 11,  3,  8,  0,  5
 };
 
-uint8_t physicalToFibonacciOrder[100] = {
+constexpr uint8_t physicalToFibonacciOrder[100] = {
   98, 93, 88, 96, 91, 99, 94, 89, 97, 92,
   87, 95, 90, 85, 80, 75, 83, 78, 86, 81,
   76, 84, 79, 74, 82, 77, 72, 67, 62, 70,
@@ -35,21 +35,254 @@ const uint8_t maxY = kMatrixHeight - 1;
 
 #define COORD_NUM_LEDS 100
 
-const uint8_t coordsX10[COORD_NUM_LEDS] = { 5, 4, 5, 5, 4, 5, 4, 4, 6, 3, 5, 5, 3, 6, 4, 4, 6, 3, 6, 4, 3, 7, 3, 5, 6, 2, 7, 4, 4, 7, 2, 6, 5, 2, 7, 3, 5, 6, 2, 7, 4, 3, 7, 2, 6, 6, 2, 8, 3, 4, 7, 1, 7, 5, 2, 8, 2, 5, 6, 1, 8, 3, 3, 8, 1, 6, 5, 1, 8, 2, 4, 7, 1, 7, 4, 2, 8, 1, 6, 6, 1, 8, 3, 3, 8, 0, 7, 5, 1, 9, 1, 5, 7, 0, 8, 3, 2, 9, 0, 6 };
+constexpr uint8_t coordsX10[COORD_NUM_LEDS] = { 5, 4, 5, 5, 4, 5, 4, 4, 6, 3, 5, 5, 3, 6, 4, 4, 6, 3, 6, 4, 3, 7, 3, 5, 6, 2, 7, 4, 4, 7, 2, 6, 5, 2, 7, 3, 5, 6, 2, 7, 4, 3, 7, 2, 6, 6, 2, 8, 3, 4, 7, 1, 7, 5, 2, 8, 2, 5, 6, 1, 8, 3, 3, 8, 1, 6, 5, 1, 8, 2, 4, 7, 1, 7, 4, 2, 8, 1, 6, 6, 1, 8, 3, 3, 8, 0, 7, 5, 1, 9, 1, 5, 7, 0, 8, 3, 2, 9, 0, 6 };
 
-const uint8_t coordsY10[COORD_NUM_LEDS] = { 5, 4, 5, 4, 5, 5, 3, 6, 4, 4, 6, 3, 5, 5, 3, 6, 3, 4, 6, 2, 6, 4, 3, 7, 3, 5, 5, 2, 7, 3, 4, 7, 2, 6, 5, 3, 7, 2, 5, 6, 2, 7, 4, 3, 7, 2, 6, 5, 2, 8, 3, 4, 7, 1, 7, 4, 2, 8, 2, 5, 6, 1, 8, 3, 3, 8, 1, 7, 5, 2, 8, 2, 5, 7, 1, 8, 4, 2, 8, 1, 6, 6, 1, 8, 2, 4, 8, 0, 7, 5, 1, 9, 1, 5, 7, 0, 8, 3, 3, 9 };
+constexpr uint8_t coordsY10[COORD_NUM_LEDS] = { 5, 4, 5, 4, 5, 5, 3, 6, 4, 4, 6, 3, 5, 5, 3, 6, 3, 4, 6, 2, 6, 4, 3, 7, 3, 5, 5, 2, 7, 3, 4, 7, 2, 6, 5, 3, 7, 2, 5, 6, 2, 7, 4, 3, 7, 2, 6, 5, 2, 8, 3, 4, 7, 1, 7, 4, 2, 8, 2, 5, 6, 1, 8, 3, 3, 8, 1, 7, 5, 2, 8, 2, 5, 7, 1, 8, 4, 2, 8, 1, 6, 6, 1, 8, 2, 4, 8, 0, 7, 5, 1, 9, 1, 5, 7, 0, 8, 3, 3, 9 };
 
-const uint8_t coordsX32[COORD_NUM_LEDS] = { 17, 15, 16, 18, 13, 19, 15, 14, 20, 11, 18, 18, 11, 22, 12, 15, 21, 9, 21, 16, 11, 23, 10, 18, 20, 8, 24, 13, 13, 24, 7, 21, 18, 9, 25, 9, 16, 23, 6, 24, 14, 10, 26, 6, 20, 20, 6, 27, 10, 14, 25, 4, 24, 16, 8, 28, 7, 18, 23, 4, 27, 12, 11, 28, 4, 22, 19, 5, 29, 8, 15, 26, 2, 26, 15, 8, 30, 4, 20, 23, 2, 30, 10, 12, 29, 1, 25, 18, 4, 31, 5, 17, 26, 0, 29, 12, 8, 31, 1, 22 };
+constexpr uint8_t coordsX32[COORD_NUM_LEDS] = { 17, 15, 16, 18, 13, 19, 15, 14, 20, 11, 18, 18, 11, 22, 12, 15, 21, 9, 21, 16, 11, 23, 10, 18, 20, 8, 24, 13, 13, 24, 7, 21, 18, 9, 25, 9, 16, 23, 6, 24, 14, 10, 26, 6, 20, 20, 6, 27, 10, 14, 25, 4, 24, 16, 8, 28, 7, 18, 23, 4, 27, 12, 11, 28, 4, 22, 19, 5, 29, 8, 15, 26, 2, 26, 15, 8, 30, 4, 20, 23, 2, 30, 10, 12, 29, 1, 25, 18, 4, 31, 5, 17, 26, 0, 29, 12, 8, 31, 1, 22 };
 
-const uint8_t coordsY32[COORD_NUM_LEDS] = { 16, 15, 19, 14, 17, 18, 12, 20, 14, 14, 21, 11, 19, 17, 11, 22, 12, 16, 21, 9, 22, 15, 12, 24, 9, 18, 20, 8, 24, 12, 14, 24, 7, 22, 17, 9, 26, 9, 17, 22, 6, 25, 13, 11, 26, 6, 21, 19, 6, 27, 9, 15, 25, 4, 25, 15, 8, 28, 6, 19, 22, 4, 28, 11, 12, 28, 3, 23, 18, 5, 30, 7, 16, 25, 2, 27, 13, 8, 30, 3, 21, 21, 3, 30, 8, 13, 28, 1, 26, 16, 5, 31, 4, 18, 25, 1, 30, 11, 9, 31 };
+constexpr uint8_t coordsY32[COORD_NUM_LEDS] = { 16, 15, 19, 14, 17, 18, 12, 20, 14, 14, 21, 11, 19, 17, 11, 22, 12, 16, 21, 9, 22, 15, 12, 24, 9, 18, 20, 8, 24, 12, 14, 24, 7, 22, 17, 9, 26, 9, 17, 22, 6, 25, 13, 11, 26, 6, 21, 19, 6, 27, 9, 15, 25, 4, 25, 15, 8, 28, 6, 19, 22, 4, 28, 11, 12, 28, 3, 23, 18, 5, 30, 7, 16, 25, 2, 27, 13, 8, 30, 3, 21, 21, 3, 30, 8, 13, 28, 1, 26, 16, 5, 31, 4, 18, 25, 1, 30, 11, 9, 31 };
 
-const uint8_t coordsX[COORD_NUM_LEDS] = { 137, 116, 130, 143, 101, 154, 119, 112, 164, 91, 146, 141, 88, 175, 100, 121, 168, 74, 168, 125, 90, 188, 77, 142, 160, 66, 189, 102, 105, 190, 59, 167, 141, 69, 204, 75, 128, 181, 48, 193, 113, 83, 210, 52, 158, 161, 48, 213, 82, 109, 203, 36, 189, 131, 61, 225, 53, 142, 184, 30, 216, 97, 85, 223, 30, 177, 154, 39, 234, 61, 120, 208, 17, 211, 117, 60, 240, 31, 159, 180, 19, 237, 77, 94, 231, 11, 198, 142, 35, 251, 40, 135, 207, 4, 232, 99, 66, 250, 11, 179 };
+constexpr uint8_t coordsX[COORD_NUM_LEDS] = { 137, 116, 130, 143, 101, 154, 119, 112, 164, 91, 146, 141, 88, 175, 100, 121, 168, 74, 168, 125, 90, 188, 77, 142, 160, 66, 189, 102, 105, 190, 59, 167, 141, 69, 204, 75, 128, 181, 48, 193, 113, 83, 210, 52, 158, 161, 48, 213, 82, 109, 203, 36, 189, 131, 61, 225, 53, 142, 184, 30, 216, 97, 85, 223, 30, 177, 154, 39, 234, 61, 120, 208, 17, 211, 117, 60, 240, 31, 159, 180, 19, 237, 77, 94, 231, 11, 198, 142, 35, 251, 40, 135, 207, 4, 232, 99, 66, 250, 11, 179 };
 
-const uint8_t coordsY[COORD_NUM_LEDS] = { 128, 117, 148, 109, 133, 144, 96, 160, 115, 113, 166, 86, 151, 138, 88, 179, 94, 126, 167, 71, 173, 120, 93, 189, 72, 148, 156, 65, 193, 95, 110, 189, 55, 174, 134, 71, 206, 69, 135, 177, 47, 199, 106, 89, 209, 47, 166, 154, 50, 217, 75, 116, 200, 33, 196, 123, 66, 225, 46, 150, 178, 31, 221, 88, 93, 221, 26, 186, 146, 43, 237, 53, 129, 202, 17, 218, 107, 68, 239, 25, 169, 172, 22, 242, 67, 103, 226, 7, 208, 132, 42, 252, 31, 146, 199, 5, 239, 88, 75, 247 };
+constexpr uint8_t coordsY[COORD_NUM_LEDS] = { 128, 117, 148, 109, 133, 144, 96, 160, 115, 113, 166, 86, 151, 138, 88, 179, 94, 126, 167, 71, 173, 120, 93, 189, 72, 148, 156, 65, 193, 95, 110, 189, 55, 174, 134, 71, 206, 69, 135, 177, 47, 199, 106, 89, 209, 47, 166, 154, 50, 217, 75, 116, 200, 33, 196, 123, 66, 225, 46, 150, 178, 31, 221, 88, 93, 221, 26, 186, 146, 43, 237, 53, 129, 202, 17, 218, 107, 68, 239, 25, 169, 172, 22, 242, 67, 103, 226, 7, 208, 132, 42, 252, 31, 146, 199, 5, 239, 88, 75, 247 };
 
-const uint8_t ledAngles[COORD_NUM_LEDS] = { 0, 158, 60, 219, 121, 23, 181, 84, 242, 144, 46, 204, 107, 9, 167, 69, 227, 130, 32, 190, 92, 251, 153, 55, 213, 115, 18, 176, 78, 236, 139, 41, 199, 101, 3, 162, 64, 222, 124, 26, 185, 87, 245, 147, 50, 208, 110, 12, 170, 73, 231, 133, 35, 193, 96, 254, 156, 58, 217, 119, 21, 179, 81, 240, 142, 44, 202, 105, 7, 165, 67, 225, 128, 30, 188, 90, 248, 151, 53, 211, 113, 16, 174, 76, 234, 136, 39, 197, 99, 1, 160, 62, 220, 122, 24, 183, 85, 243, 145, 47 };
+constexpr uint8_t ledAngles[COORD_NUM_LEDS] = { 0, 158, 60, 219, 121, 23, 181, 84, 242, 144, 46, 204, 107, 9, 167, 69, 227, 130, 32, 190, 92, 251, 153, 55, 213, 115, 18, 176, 78, 236, 139, 41, 199, 101, 3, 162, 64, 222, 124, 26, 185, 87, 245, 147, 50, 208, 110, 12, 170, 73, 231, 133, 35, 193, 96, 254, 156, 58, 217, 119, 21, 179, 81, 240, 142, 44, 202, 105, 7, 165, 67, 225, 128, 30, 188, 90, 248, 151, 53, 211, 113, 16, 174, 76, 234, 136, 39, 197, 99, 1, 160, 62, 220, 122, 24, 183, 85, 243, 145, 47 };
 
-const uint8_t ledRadii[COORD_NUM_LEDS] = { 0, 3, 5, 8, 10, 13, 15, 18, 20, 23, 26, 28, 31, 33, 36, 38, 41, 44, 46, 49, 51, 54, 56, 59, 61, 64, 67, 69, 72, 74, 77, 79, 82, 84, 87, 90, 92, 95, 97, 100, 102, 105, 108, 110, 113, 115, 118, 120, 123, 125, 128, 131, 133, 136, 138, 141, 143, 146, 148, 151, 154, 156, 159, 161, 164, 166, 169, 172, 174, 177, 179, 182, 184, 187, 189, 192, 195, 197, 200, 202, 205, 207, 210, 212, 215, 218, 220, 223, 225, 228, 230, 233, 236, 238, 241, 243, 246, 248, 251, 253 };
+constexpr uint8_t ledRadii[COORD_NUM_LEDS] = { 0, 3, 5, 8, 10, 13, 15, 18, 20, 23, 26, 28, 31, 33, 36, 38, 41, 44, 46, 49, 51, 54, 56, 59, 61, 64, 67, 69, 72, 74, 77, 79, 82, 84, 87, 90, 92, 95, 97, 100, 102, 105, 108, 110, 113, 115, 118, 120, 123, 125, 128, 131, 133, 136, 138, 141, 143, 146, 148, 151, 154, 156, 159, 161, 164, 166, 169, 172, 174, 177, 179, 182, 184, 187, 189, 192, 195, 197, 200, 202, 205, 207, 210, 212, 215, 218, 220, 223, 225, 228, 230, 233, 236, 238, 241, 243, 246, 248, 251, 253 };
+
+/*
+   XY to LED lookups, built at compile time from the coordinates above so
+   that drawing a cell doesn't scan the 100 LEDs anymore
+*/
+
+#define XY_NO_LED 255
+
+// Index lists for building tables with a pack expansion, split in halves to
+// keep the template depth low for the 1024 cells of the 32x32 grid
+template <uint16_t... I> struct IndexList {};
+
+template <class A, class B> struct ConcatIndexes;
+
+template <uint16_t... A, uint16_t... B>
+struct ConcatIndexes<IndexList<A...>, IndexList<B...> > {
+  typedef IndexList<A..., (sizeof...(A) + B)...> type;
+};
+
+template <uint16_t N> struct MakeIndexes {
+  typedef typename ConcatIndexes<typename MakeIndexes<N / 2>::type, typename MakeIndexes<N - N / 2>::type>::type type;
+};
+
+template <> struct MakeIndexes<0> { typedef IndexList<> type; };
+template <> struct MakeIndexes<1> { typedef IndexList<0> type; };
+
+template <uint16_t N>
+struct LedTable {
+  uint8_t mLeds[N];
+};
+
+// 32x32: at most one LED per cell, the first one in physical order like the scan found
+constexpr uint8_t findLedXY(uint8_t x, uint8_t y, uint8_t i = 0) {
+  return i == COORD_NUM_LEDS ? XY_NO_LED :
+         (coordsX32[physicalToFibonacciOrder[i]] == x && coordsY32[physicalToFibonacciOrder[i]] == y) ? i :
+         findLedXY(x, y, i + 1);
+}
+
+template <uint16_t... I>
+constexpr LedTable<sizeof...(I)> makeXYTable(IndexList<I...>) {
+  return {{ findLedXY(I % kMatrixWidth, I / kMatrixWidth)... }};
+}
+
+// LED at y * kMatrixWidth + x, or XY_NO_LED
+constexpr LedTable<kMatrixWidth * kMatrixHeight> xyToLed = makeXYTable(MakeIndexes<kMatrixWidth * kMatrixHeight>::type());
+
+// 10x10: up to 3 LEDs per cell, in buckets sorted by cell
+constexpr uint8_t cellXY10(uint8_t i) {
+  return coordsY10[physicalToFibonacciOrder[i]] * 10 + coordsX10[physicalToFibonacciOrder[i]];
+}
+
+// LEDs in the cells before cell
+constexpr uint8_t countLedsBefore(uint8_t cell, uint8_t i = 0) {
+  return i == COORD_NUM_LEDS ? 0 : (cellXY10(i) < cell) + countLedsBefore(cell, i + 1);
+}
+
+// Position of LED i in the buckets
+constexpr uint8_t bucketPosition(uint8_t i, uint8_t j = 0) {
+  return j == i ? countLedsBefore(cellXY10(i)) : (cellXY10(j) == cellXY10(i)) + bucketPosition(i, j + 1);
+}
+
+constexpr uint8_t bucketLed(uint8_t position, uint8_t i = 0) {
+  return i == COORD_NUM_LEDS ? XY_NO_LED : bucketPosition(i) == position ? i : bucketLed(position, i + 1);
+}
+
+template <uint16_t... I>
+constexpr LedTable<sizeof...(I)> makeBucketStarts(IndexList<I...>) {
+  return {{ countLedsBefore(I)... }};
+}
+
+template <uint16_t... I>
+constexpr LedTable<sizeof...(I)> makeBucketLeds(IndexList<I...>) {
+  return {{ bucketLed(I)... }};
+}
+
+// The LEDs of cell y * 10 + x are xy10Leds[xy10Starts[cell]] up to xy10Leds[xy10Starts[cell + 1]]
+constexpr LedTable<10 * 10 + 1> xy10Starts = makeBucketStarts(MakeIndexes<10 * 10 + 1>::type());
+constexpr LedTable<COORD_NUM_LEDS> xy10Leds = makeBucketLeds(MakeIndexes<COORD_NUM_LEDS>::type());
+
+static_assert(xy10Starts.mLeds[10 * 10] == COORD_NUM_LEDS, "Every LED has a 10x10 cell");
+
+// Where every LED is, in physical order, side by side for the loops over
+// all the LEDs instead of going through the Fibonacci order each time
+typedef struct {
+  uint8_t mX[COORD_NUM_LEDS];         // 256x256 coordinates, y grows downwards
+  uint8_t mY[COORD_NUM_LEDS];
+  uint8_t mAngle[COORD_NUM_LEDS];     // around the center
+  uint8_t mRadius[COORD_NUM_LEDS];    // from the center
+  uint8_t mFibIndex[COORD_NUM_LEDS];  // along the Fibonacci spiral, 0 in the center
+} LedGeometry;
+
+template <uint16_t... I>
+constexpr LedGeometry makeLedGeometry(IndexList<I...>) {
+  return {
+    { coordsX[physicalToFibonacciOrder[I]]... },
+    { coordsY[physicalToFibonacciOrder[I]]... },
+    { ledAngles[physicalToFibonacciOrder[I]]... },
+    { ledRadii[physicalToFibonacciOrder[I]]... },
+    { physicalToFibonacciOrder[I]... }
+  };
+}
+
+constexpr LedGeometry ledGeometry = makeLedGeometry(MakeIndexes<COORD_NUM_LEDS>::type());
+
+// The nearest LEDs of every LED, so that automata can run on the LEDs
+// themselves. Most LEDs of the spiral have 6 neighbours around them.
+#define LED_NEIGHBOURS 6
+
+// Heat rises from the 2 nearest LEDs below (or falls from the 2 above),
+// within 45 degrees of straight down (or up)
+#define LED_SOURCES 2
+
+#define NEIGHBOURS_AROUND 0
+#define NEIGHBOURS_BELOW  1
+#define NEIGHBOURS_ABOVE  2
+
+constexpr int32_t ledDistance2(uint8_t a, uint8_t b) {
+  return (int32_t)(ledGeometry.mX[a] - ledGeometry.mX[b]) * (ledGeometry.mX[a] - ledGeometry.mX[b]) +
+         (int32_t)(ledGeometry.mY[a] - ledGeometry.mY[b]) * (ledGeometry.mY[a] - ledGeometry.mY[b]);
+}
+
+// Within 45 degrees of straight down, dy > 0 being down
+constexpr bool inCone(int16_t dx, int16_t dy) {
+  return dy > 0 && dy >= abs(dx);
+}
+
+constexpr bool inDirection(uint8_t i, uint8_t q, uint8_t direction) {
+  return direction == NEIGHBOURS_AROUND ? q != i :
+         direction == NEIGHBOURS_BELOW ? inCone(ledGeometry.mX[q] - ledGeometry.mX[i], ledGeometry.mY[q] - ledGeometry.mY[i]) :
+         inCone(ledGeometry.mX[q] - ledGeometry.mX[i], ledGeometry.mY[i] - ledGeometry.mY[q]);
+}
+
+// p is nearer than q, ties go to the lower index
+constexpr bool nearerDistance(int32_t distanceP, int32_t distanceQ, uint8_t p, uint8_t q) {
+  return distanceP < distanceQ || (distanceP == distanceQ && p < q);
+}
+
+constexpr uint8_t nextNearestStep(uint8_t i, uint8_t direction, uint8_t after, int32_t afterDistance,
+                                  uint8_t q, uint8_t best, int32_t bestDistance, int32_t distance);
+
+// Nearest LED to i in direction after the LED after, in the nearness order.
+// Distances are carried along, computing them is what makes the tables slow to build.
+constexpr uint8_t nextNearestLed(uint8_t i, uint8_t direction, uint8_t after, int32_t afterDistance,
+                                 uint8_t q = 0, uint8_t best = XY_NO_LED, int32_t bestDistance = 0) {
+  return q == COORD_NUM_LEDS ? best :
+         nextNearestStep(i, direction, after, afterDistance, q, best, bestDistance, ledDistance2(i, q));
+}
+
+constexpr uint8_t nextNearestStep(uint8_t i, uint8_t direction, uint8_t after, int32_t afterDistance,
+                                  uint8_t q, uint8_t best, int32_t bestDistance, int32_t distance) {
+  return (inDirection(i, q, direction) &&
+          (after == XY_NO_LED || nearerDistance(afterDistance, distance, after, q)) &&
+          (best == XY_NO_LED || nearerDistance(distance, bestDistance, q, best))) ?
+         nextNearestLed(i, direction, after, afterDistance, q + 1, q, distance) :
+         nextNearestLed(i, direction, after, afterDistance, q + 1, best, bestDistance);
+}
+
+constexpr uint8_t nearestAfter(uint8_t i, uint8_t direction, uint8_t previous) {
+  return previous == XY_NO_LED ? XY_NO_LED : nextNearestLed(i, direction, previous, ledDistance2(i, previous));
+}
+
+// XY_NO_LED when there are less than rank + 1 LEDs that way
+constexpr uint8_t nearestLed(uint8_t i, uint8_t direction, uint8_t rank) {
+  return rank == 0 ? nextNearestLed(i, direction, XY_NO_LED, 0) : nearestAfter(i, direction, nearestLed(i, direction, rank - 1));
+}
+
+template <uint8_t Direction, uint8_t Count, uint16_t... I>
+constexpr LedTable<sizeof...(I)> makeNeighbourTable(IndexList<I...>) {
+  return {{ nearestLed(I / Count, Direction, I % Count)... }};
+}
+
+// Neighbours of LED i are ledNeighbours[i * LED_NEIGHBOURS] onwards, nearest first
+constexpr LedTable<COORD_NUM_LEDS * LED_NEIGHBOURS> ledNeighbours =
+  makeNeighbourTable<NEIGHBOURS_AROUND, LED_NEIGHBOURS>(MakeIndexes<COORD_NUM_LEDS * LED_NEIGHBOURS>::type());
+
+// Same for the LEDs below and above, XY_NO_LED on the edges
+constexpr LedTable<COORD_NUM_LEDS * LED_SOURCES> ledsBelow =
+  makeNeighbourTable<NEIGHBOURS_BELOW, LED_SOURCES>(MakeIndexes<COORD_NUM_LEDS * LED_SOURCES>::type());
+constexpr LedTable<COORD_NUM_LEDS * LED_SOURCES> ledsAbove =
+  makeNeighbourTable<NEIGHBOURS_ABOVE, LED_SOURCES>(MakeIndexes<COORD_NUM_LEDS * LED_SOURCES>::type());
+
+// q comes after p from the top, ties go to the lower index
+constexpr bool lowerLed(uint8_t q, uint8_t p) {
+  return ledGeometry.mY[q] > ledGeometry.mY[p] || (ledGeometry.mY[q] == ledGeometry.mY[p] && q > p);
+}
+
+// Next LED from the top after the LED after
+constexpr uint8_t nextLedDown(uint8_t after, uint8_t q = 0, uint8_t best = XY_NO_LED) {
+  return q == COORD_NUM_LEDS ? best :
+         nextLedDown(after, q + 1,
+                     ((after == XY_NO_LED || lowerLed(q, after)) && (best == XY_NO_LED || lowerLed(best, q))) ? q : best);
+}
+
+constexpr uint8_t ledFromTop(uint8_t rank) {
+  return nextLedDown(rank == 0 ? XY_NO_LED : ledFromTop(rank - 1));
+}
+
+template <uint16_t... I>
+constexpr LedTable<sizeof...(I)> makeTopDownTable(IndexList<I...>) {
+  return {{ ledFromTop(I)... }};
+}
+
+// The LEDs from the top to the bottom
+constexpr LedTable<COORD_NUM_LEDS> ledsTopDown = makeTopDownTable(MakeIndexes<COORD_NUM_LEDS>::type());
+
+/*
+   Pixel shaders: a shader is a functor that returns the color of a LED
+   from where it is,
+     CRGB operator()(uint8_t x, uint8_t y, uint8_t angle, uint8_t radius, uint8_t fibIndex, uint32_t t) const
+   with t in ms, and shade() runs it over all the LEDs. Every shader type
+   gets its own inlined loop, frame constants go in the functor's members.
+*/
+
+template <class Shader>
+inline void shade(const Shader& shader, uint32_t t) {
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    leds[i] = shader(ledGeometry.mX[i], ledGeometry.mY[i], ledGeometry.mAngle[i], ledGeometry.mRadius[i], ledGeometry.mFibIndex[i], t);
+  }
+}
+
+// Same, blended over what's in leds
+template <class Shader>
+inline void shadeOver(const Shader& shader, uint32_t t, fract8 amount) {
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    nblend(leds[i], shader(ledGeometry.mX[i], ledGeometry.mY[i], ledGeometry.mAngle[i], ledGeometry.mRadius[i], ledGeometry.mFibIndex[i], t), amount);
+  }
+}
+
+// beatsin88() at t, so that shaders don't read the clock for every LED
+inline uint16_t beatsin88At(uint32_t t, accum88 beatsPerMinute88, uint16_t lowest, uint16_t highest) {
+  uint16_t beat = (t * beatsPerMinute88 * 280) >> 16;
+  return lowest + scale16(sin16(beat) + 32768, highest - lowest);
+}
 
 void setPixelXY10(uint8_t x, uint8_t y, CRGB color)
 {
@@ -57,12 +290,10 @@ void setPixelXY10(uint8_t x, uint8_t y, CRGB color)
     return;
   }
 
-  for (uint8_t i = 0; i < NUM_LEDS; i++) {
-    uint8_t o = physicalToFibonacciOrder[i];
-    
-    if (coordsX10[o] == x && coordsY10[o] == y) {
-      leds[i] = color;
-    }
+  uint8_t cell = y * 10 + x;
+
+  for (uint8_t b = xy10Starts.mLeds[cell]; b < xy10Starts.mLeds[cell + 1]; b++) {
+    leds[xy10Leds.mLeds[b]] = color;
   }
 }
 
@@ -73,14 +304,8 @@ void setPixelXY(uint8_t x, uint8_t y, CRGB color)
     return;
   }
 
-  for (uint8_t i = 0; i < NUM_LEDS; i++) {
-    uint8_t o = physicalToFibonacciOrder[i];
-    
-    if (coordsX32[o] == x && coordsY32[o] == y) {
-      leds[i] = color;
-      return;
-    }
-  }
+  uint8_t i = xyToLed.mLeds[y * kMatrixWidth + x];
+  if (i != XY_NO_LED) leds[i] = color;
 }
 
 
@@ -118,6 +343,60 @@ void drawCircle(uint8_t x0, uint8_t y0, uint8_t radius, const CRGB color)
 }
 
 
+/*
+   Rings and discs drawn from each LED's squared distance to the center on
+   the 256x256 coordinates, in one pass over the LEDs. The distance to a
+   ring of radius r is about |d^2 - r^2| / 2r, so there's no square root
+   and two divisions per ring, one per side of the edge. Edges are
+   antialiased over width, within 10/255 of edges drawn from the exact
+   distance and within 5/255 from a radius of 64 up
+   (tests/host/check_rings.cpp).
+*/
+
+// How much of a LED the edge covers, 0-255, from its squared distance error
+inline uint8_t edgeCoverage(uint32_t error, uint32_t falloff, uint32_t scale) {
+  if (error >= falloff) return 0;
+  return 255 - ((error * scale) >> 16);
+}
+
+void drawRound(int16_t x0, int16_t y0, uint8_t radius, uint8_t width, const CRGB& color, bool filled)
+{
+  uint8_t halfWidth = max(width / 2, 1);
+  int32_t radius2 = (int32_t)radius * radius;
+
+  // Squared distance errors where the edge fades out, half a width outside
+  // and inside the radius. d^2 - r^2 grows faster outside, one falloff for
+  // both sides would leave the inside of the edge about 50/255 too bright.
+  uint32_t outside = (2 * (uint32_t)radius + halfWidth) * halfWidth;
+  uint32_t outsideScale = (255UL << 16) / outside;
+  // Small rings fade out at the center
+  uint32_t inside = radius > halfWidth ? (2 * (uint32_t)radius - halfWidth) * halfWidth : (uint32_t)radius * halfWidth;
+  uint32_t insideScale = inside ? (255UL << 16) / inside : 0;
+
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    int32_t dx = ledGeometry.mX[i] - x0;
+    int32_t dy = ledGeometry.mY[i] - y0;
+    int32_t error = dx * dx + dy * dy - radius2;
+
+    uint8_t coverage;
+    if (error >= 0) coverage = edgeCoverage(error, outside, outsideScale);
+    else coverage = filled ? 255 : edgeCoverage(-error, inside, insideScale);
+
+    if (coverage) nblend(leds[i], color, coverage);
+  }
+}
+
+void drawRing(int16_t x0, int16_t y0, uint8_t radius, uint8_t width, const CRGB& color)
+{
+  drawRound(x0, y0, radius, width, color, false);
+}
+
+void drawDisc(int16_t x0, int16_t y0, uint8_t radius, uint8_t width, const CRGB& color)
+{
+  drawRound(x0, y0, radius, width, color, true);
+}
+
+
 // scale the brightness of all pixels down
 void dimAll(byte value)
 {
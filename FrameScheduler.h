@@ -0,0 +1,65 @@
+#ifndef FRAME_SCHEDULER
+#define FRAME_SCHEDULER
+
+#include <Arduino.h>
+
+// Frames starting later than this after their deadline count as overruns
+#define FRAME_OVERRUN_TOLERANCE_US 500
+
+// Keeps frames on an absolute micros() timeline: the time spent rendering,
+// mirroring, talking to MQTT and showing is taken out of the frame period
+// instead of being added on top of it.
+class FrameScheduler {
+
+  public:
+
+    FrameScheduler() : _deadline(0), _workTime(0), _maxLateness(0),
+                       _frames(0), _overruns(0) {}
+
+    // When the frame after the current one is due
+    uint32_t getNextDeadline(uint32_t periodMicros) {
+      return _deadline + periodMicros;
+    }
+
+    // Starts the frame that was due periodMicros after the previous one.
+    // A late frame is counted as an overrun and the timeline restarts from
+    // now rather than bursting frames to catch up.
+    void beginFrame(uint32_t periodMicros) {
+      uint32_t now = micros();
+
+      _deadline += periodMicros;
+
+      int32_t lateness = (int32_t)(now - _deadline);
+
+      if (lateness > FRAME_OVERRUN_TOLERANCE_US || _frames == 0) {
+        if (_frames > 0) {
+          _overruns++;
+          if ((uint32_t)lateness > _maxLateness) _maxLateness = lateness;
+        }
+        _deadline = now;
+      }
+
+      _frames++;
+    }
+
+    // Marks the end of the work done for the frame
+    void endFrame() {
+      _workTime = micros() - _deadline;
+    }
+
+    // Time spent between the deadline and the end of the frame's work, in us
+    uint32_t getWorkTime()    { return _workTime; }
+    uint32_t getMaxLateness() { return _maxLateness; }
+    uint32_t getFrameCount()  { return _frames; }
+    uint32_t getOverruns()    { return _overruns; }
+
+  private:
+
+    uint32_t _deadline;
+    uint32_t _workTime;
+    uint32_t _maxLateness;
+    uint32_t _frames;
+    uint32_t _overruns;
+};
+
+#endif
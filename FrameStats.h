@@ -0,0 +1,151 @@
+#ifndef FRAME_STATS
+#define FRAME_STATS
+
+#include <Arduino.h>
+
+// Stages of a frame, timed separately for every animation
+typedef enum FrameStage {
+  STAGE_ANIMATE = 0,
+  STAGE_MIRROR,
+  STAGE_MQTT,
+  STAGE_DELAY,
+  STAGE_SHOW,
+  STAGE_TRANSITION,   // extra cost of blending two animations
+  STAGE_COUNT
+} FrameStage;
+
+const char* const gFrameStageNames[STAGE_COUNT] = {"animate", "mirror", "mqtt", "delay", "show", "transition"};
+
+// Half-octave bucket upper bounds in us, the last bucket takes everything above
+#define FRAME_STAT_BUCKETS 16
+const uint16_t gFrameStatBounds[FRAME_STAT_BUCKETS - 1] = {
+  64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 12288
+};
+
+// 12 bytes per animation slot and stage
+typedef struct {
+  uint16_t minTime;
+  uint16_t maxTime;
+  uint32_t totalTime;
+  uint16_t samples;
+} StageSummary;
+
+// Min/avg/max of every stage for every animation slot, and bucketed times
+// for the percentiles of the animation that's on only: the histograms
+// follow the last slot recorded and start over when it changes. With 27
+// slots that's about 2 KB instead of 4.5 KB for a histogram per slot.
+template <uint8_t SLOTS>
+class FrameStats {
+
+  public:
+
+    FrameStats() {
+      reset();
+    }
+
+    void reset() {
+      memset(_summaries, 0, sizeof(_summaries));
+      for (uint8_t slot = 0; slot < SLOTS; slot++) {
+        for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+          _summaries[slot][stage].minTime = 0xFFFF;
+        }
+      }
+      memset(_buckets, 0, sizeof(_buckets));
+      _detailedSlot = 0;
+    }
+
+    void record(uint8_t slot, FrameStage stage, uint32_t time) {
+      if (slot >= SLOTS) return;
+
+      StageSummary& h = _summaries[slot][stage];
+      uint16_t t = time > 0xFFFF ? 0xFFFF : time;
+
+      if (h.samples == 0xFFFF) {
+        h.samples >>= 1;
+        h.totalTime >>= 1;
+      }
+      h.samples++;
+      h.totalTime += t;
+
+      if (t < h.minTime) h.minTime = t;
+      if (t > h.maxTime) h.maxTime = t;
+
+      if (slot != _detailedSlot) {
+        _detailedSlot = slot;
+        memset(_buckets, 0, sizeof(_buckets));
+      }
+
+      uint8_t bucket = 0;
+      while (bucket < FRAME_STAT_BUCKETS - 1 && t > gFrameStatBounds[bucket]) bucket++;
+
+      // Bucket counts are 8 bits, halving all of them when one saturates
+      // keeps the distribution's shape
+      uint8_t* buckets = _buckets[stage];
+      if (buckets[bucket] == 0xFF) {
+        for (uint8_t i = 0; i < FRAME_STAT_BUCKETS; i++) buckets[i] >>= 1;
+      }
+      buckets[bucket]++;
+    }
+
+    // Upper bound of the bucket holding the given percentile of the detailed
+    // slot, capped by the max
+    uint16_t percentile(FrameStage stage, uint8_t percent) {
+      const uint8_t* buckets = _buckets[stage];
+      uint16_t maxTime = _summaries[_detailedSlot][stage].maxTime;
+
+      uint16_t total = 0;
+      for (uint8_t i = 0; i < FRAME_STAT_BUCKETS; i++) total += buckets[i];
+      if (total == 0) return 0;
+
+      uint16_t rank = ((uint32_t)total * percent + 99) / 100;
+      uint16_t seen = 0;
+      for (uint8_t i = 0; i < FRAME_STAT_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return min(gFrameStatBounds[i], maxTime);
+      }
+      return maxTime;
+    }
+
+    // One line per slot and stage: min/avg/p95/p99/max in us, the
+    // percentiles are only known for the detailed slot
+    void dump(uint8_t firstSlot = 0, uint8_t lastSlot = SLOTS - 1) {
+      Serial.print("Frame stats RAM (bytes): ");
+      Serial.print(sizeof(*this));
+      Serial.print(" || Percentiles for slot ");
+      Serial.println(_detailedSlot);
+
+      Serial.println("slot stage min avg p95 p99 max (us)");
+      for (uint8_t slot = firstSlot; slot <= lastSlot && slot < SLOTS; slot++) {
+        for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+          StageSummary& h = _summaries[slot][stage];
+          if (h.samples == 0) continue;
+
+          Serial.print(slot);
+          Serial.print(" ");
+          Serial.print(gFrameStageNames[stage]);
+          Serial.print(" ");
+          Serial.print(h.minTime);
+          Serial.print(" ");
+          Serial.print(h.totalTime / h.samples);
+          Serial.print(" ");
+          if (slot == _detailedSlot) {
+            Serial.print(percentile((FrameStage)stage, 95));
+            Serial.print(" ");
+            Serial.print(percentile((FrameStage)stage, 99));
+          } else {
+            Serial.print("- -");
+          }
+          Serial.print(" ");
+          Serial.println(h.maxTime);
+        }
+      }
+    }
+
+  private:
+
+    StageSummary _summaries[SLOTS][STAGE_COUNT];
+    uint8_t _buckets[STAGE_COUNT][FRAME_STAT_BUCKETS];
+    uint8_t _detailedSlot;
+};
+
+#endif
@@ -8,9 +8,18 @@
 #define USE_SETTINGS        0
 #define USE_MEMBRANE_SWITCH 0
 #define USE_IOT             0
+#define USE_DOUBLE_BUFFER   0   // front/back frames, no gain with the blocking show(), see below
+#define USE_LAYERS          1   // animations drawn over others, see Compositor.h
+#define USE_FRAME_STATS     1   // 'h' over serial dumps the frame times, ~2 KB, DEBUG builds only
+#define USE_PALETTE_CACHE   1   // 256 expanded palette colors, 768 bytes, see PaletteMgr.h
 #define DEBUG
 #include "DebugUtils.h"
 
+#ifndef DEBUG
+#undef  USE_FRAME_STATS
+#define USE_FRAME_STATS     0
+#endif
+
 #define ARRAY_SIZE(A) (sizeof(A) / sizeof((A)[0]))
 /**
    LEDS
@@ -19,7 +28,28 @@
 #define STRIP_SIZE      100
 #define LED40_PIN       10
 #define LED60_PIN        6
-struct CRGB leds[STRIP_SIZE];
+#define FIRST_2_RINGS_NUM_LEDS  40
+
+// Spare pixel past the end of the frame that always reads black
+#define BLACK_PIXEL     STRIP_SIZE
+
+#if USE_DOUBLE_BUFFER
+// Animations render the next frame into the back buffer (leds) while the
+// front buffer (prevLeds) holds the frame that is currently on the strips.
+// FastLED's clockless driver blocks in show(), so on the M0 rendering and
+// output don't overlap: this only costs 303 bytes, a copy and a frame of
+// latency per frame, the gain needs an asynchronous (DMA) output driver.
+struct CRGB ledBuffers[2][STRIP_SIZE + 1];
+CRGB* leds = ledBuffers[0];
+CRGB* prevLeds = ledBuffers[1];
+#else
+struct CRGB ledBuffers[1][STRIP_SIZE + 1];
+CRGB* leds = ledBuffers[0];
+CRGB* prevLeds = ledBuffers[0];
+#endif
+
+// Mirrors, swaps and shows the frame rendered in leds
+void presentFrame();
 
 #if USE_2ND_STRIP
 #define STRIP2_SIZE     29   // must be shorter than STRIP_SIZE
@@ -34,6 +64,13 @@ struct CRGB leds2[STRIP2_SIZE * 2];
 
 #define DEFAULT_BRIGHTNESS 200
 #define FRAMES_PER_SECOND  100
+#define FRAME_PERIOD_MS    (1000 / FRAMES_PER_SECOND)
+
+#include "FrameScheduler.h"
+FrameScheduler frameScheduler;
+
+#include "PowerLimiter.h"
+PowerLimiter powerLimiter;
 
 /**
    Button Switcher
@@ -51,11 +88,13 @@ XButton mButton(MEMBRANE_BUTTON_PIN, true);
    Animations
 */
 
+#include "ScratchArena.h"
+ScratchArena arena;
 #include "PaletteMgr.h"
 PaletteMgr palettes;
 #include "Animations.h"
+AnimationSlots animations;
 
-//#include "GradientPalettes.h"
 // 10 seconds per color palette makes a good demo, 20-120 is better for deployment
 #define SECONDS_PER_PALETTE    30
 #define AUTOPLAY_ENABLED       1
@@ -77,6 +116,32 @@ PaletteMgr palettes;
 #define MIC_PIN A4
 #include "SoundReactive.h"
 
+/**
+   Transitions
+*/
+#include "Transition.h"
+Transition transition;
+uint8_t gTransitionType = TRANSITION_FADE;
+
+/**
+   Layers
+*/
+#if USE_LAYERS
+#include "Compositor.h"
+Compositor compositor;
+
+// Sound VU on top of the color waves
+const LayerPattern gVuOverWaves[] = {
+  {makeAnimation<SoundAnimation>, 0, 60, LAYER_MAX, 0}
+};
+
+// Twinkles over pride, pulsing to 60 BPM
+const LayerPattern gSparklingPride[] = {
+  {makeAnimation<TwinkleFoxAnimation>, 6, 3, LAYER_SCREEN, 0},
+  {makeAnimation<BpmMask>, 60, 0, LAYER_MASK, 0}
+};
+#endif
+
 
 /**
    Sequencing
@@ -84,59 +149,70 @@ PaletteMgr palettes;
 AnimationPattern gAnimations[] = {
 
    // test pulse - no
-  {soundAnimate, 2, 10}, 
+  {makeAnimation<SoundAnimation>, 2, 10}, 
 
-  {beatTriggered, 20, 100},
+  {makeAnimation<BeatTriggered>, 20, 100},
 
-  {sinelon, 120, 2},
+  {makeAnimation<Sinelon>, 120, 2},
 
   // breathing full colors, rapid changes of color tones. #warm #powerful
-  {wave, 0, 0},
+  {makeAnimation<Wave>, 0, 0},
 
-  {discostrobe, 40, 2},
+  {makeAnimation<DiscoStrobe>, 40, 2},
 
   // should use the general palette
-  {twinkleFox, 6, 1},
+  {makeAnimation<TwinkleFoxAnimation>, 6, 1},
 
-  {multiFire, 70, 60},
+  {makeAnimation<MultiFire>, 70, 60},
 
   // [use CPT]
-  {colorWaves, 1, 0}, // using Fibonacci, I think this one is the best
+  {makeAnimation<ColorWaves>, 1, 0}, // using Fibonacci, I think this one is the best
 
   // Slowercolor changes, create powerful color effects #mesmerizing [use CPT]
-  {radialPaletteShift, 0, 0},
+  {makeStateless<radialPaletteShift>, 0, 0},
 
   // Fully colored, subtle changes [use CPT]
-  {incrementalDrift, 0, 0},
+  {makeStateless<incrementalDrift>, 0, 0},
 
-  {pulse, 0, 0},
+  {makeAnimation<Pulse>, 0, 0},
 
-  {life, 0, 0},
+  {makeAnimation<Life>, 0, 0},
 
-  {breathing, 24, 33},
+  // Hexagonal Life on the LEDs' own neighbours, B2/S34
+  {makeAnimation<LedAutomaton>, NEIGHBOURS(2), NEIGHBOURS(3) | NEIGHBOURS(4), 40},
 
-  {pride,    0,   0},
+  {makeAnimation<Breathing>, 24, 33},
+
+  {makeAnimation<Pride>,    0,   0},
 
   // make ripple work with color palette
-  {ripple,  60,  40},
+  {makeAnimation<Ripple>,  60,  40},
+
+  {makeAnimation<Ripple2D>, 200, 40},
 
-  {sinelon,  13, 4},
+  {makeAnimation<Sinelon>,  13, 4},
 
-  {juggle,   4, 8},
+  {makeStateless<juggle>,   4, 8},
 
   // Pastel colors
-  {verticalRainbow, 0, 0},
+  {makeStateless<verticalRainbow>, 0, 0},
 
-  {applause, HUE_BLUE, HUE_RED},
+  {makeAnimation<Applause>, HUE_BLUE, HUE_RED},
 
-  {confetti, 20, 10},
+  {makeStateless<confetti>, 20, 10},
 
-  {bpm,      120, 7}
+  {makeStateless<bpm>,      120, 7},
+
+#if USE_LAYERS
+  {makeAnimation<ColorWaves>, 1, 0, 0, gVuOverWaves, ARRAY_SIZE(gVuOverWaves)},
+
+  {makeAnimation<Pride>, 0, 0, 0, gSparklingPride, ARRAY_SIZE(gSparklingPride)},
+#endif
 };
 
 AnimationPattern gDropAnimations[] = {
-  {aboutToDrop, 100, 200},
-  {discostrobe, 120, 2}
+  {makeAnimation<AboutToDrop>, 100, 200},
+  {makeAnimation<DiscoStrobe>, 120, 2}
 };
 
 // Default sequence to main animations
@@ -144,10 +220,34 @@ volatile AnimationPattern* gSequence = gAnimations;
 // Index number of which pattern is current
 volatile uint8_t gCurrentPatternNumber = 0;
 
+// Stats slot of the current animation: gAnimations first, then gDropAnimations
+uint8_t currentAnimationSlot() {
+  if (gSequence == gAnimations) return gCurrentPatternNumber;
+  return ARRAY_SIZE(gAnimations) + gCurrentPatternNumber;
+}
+
+#if USE_FRAME_STATS
+#include "FrameStats.h"
+FrameStats<ARRAY_SIZE(gAnimations) + ARRAY_SIZE(gDropAnimations)> frameStats;
+
+// Most scratch memory in use while each animation was on, in bytes
+uint16_t gArenaPeaks[ARRAY_SIZE(gAnimations) + ARRAY_SIZE(gDropAnimations)];
+
+void dumpArenaPeaks() {
+  arena.dump();
+  for (uint8_t slot = 0; slot < ARRAY_SIZE(gArenaPeaks); slot++) {
+    Serial.print(slot < ARRAY_SIZE(gAnimations) ? "anim " : "drop ");
+    Serial.print(slot < ARRAY_SIZE(gAnimations) ? slot : slot - ARRAY_SIZE(gAnimations));
+    Serial.print(" arena peak: ");
+    Serial.println(gArenaPeaks[slot]);
+  }
+}
+#endif
+
 
 void onClick() {
   
-  showBeat(250);
+  startBeat(250);
 
   if (gSequence == gAnimations) {
     gCurrentPatternNumber =  addmod8(gCurrentPatternNumber, 1, ARRAY_SIZE(gAnimations));
@@ -167,7 +267,7 @@ void onDoubleClick() {
   //Reseting to first animation
   PRINT("Double click");
 
-  showBeat(100);
+  startBeat(100);
 
   if (gCurrentPatternNumber == 0 || gCurrentPatternNumber == 1) {
     // We're already at the first animation - spice things up
@@ -181,7 +281,6 @@ void onLongPressStart() {
   PRINT("Long press");
 
   gSequence = gDropAnimations;
-  initDropAnimations();
 
   gCurrentPatternNumber = 0;
 }
@@ -202,12 +301,36 @@ void onTripleClick() {
 #endif
 }
 
+// Makes the frame rendered in leds the one that's shown. The new back buffer
+// starts as a copy of it so that incremental animations (fades, trails) keep
+// drawing on top of the previous frame.
+void swapFrameBuffers() {
+#if USE_DOUBLE_BUFFER
+  CRGB* front = leds;
+  leds = prevLeds;
+  prevLeds = front;
+
+  FastLED[0].setLeds(front, FIRST_2_RINGS_NUM_LEDS);
+  FastLED[1].setLeds(front + FIRST_2_RINGS_NUM_LEDS, STRIP_SIZE - FIRST_2_RINGS_NUM_LEDS);
+
+  memcpy(leds, front, sizeof(ledBuffers[0]));
+#endif
+}
+
 // Showing Battery level
 
 #define BATT_MIN_MV 3350 // Some headroom over battery cutoff near 2.9V
 #define BATT_MAX_MV 4200 // And little below fresh-charged battery near 4.1V
 
-void showBatteryLevel() {
+// The gauge fills up over BATTERY_INTRO_FILL_MS and stays over the first
+// animation until BATTERY_INTRO_MS after boot
+#define BATTERY_INTRO_FILL_MS  500
+#define BATTERY_INTRO_MS      2000
+#define BATTERY_INTRO_BLEND    160  // gauge share of the blended LEDs, 0-255
+
+uint8_t gBatteryIntroLevel = 0;
+
+void startBatteryIntro() {
 
   float mV = getBatteryLevel() * 1000;
   PRINTX("Battery level:", mV);
@@ -219,18 +342,56 @@ void showBatteryLevel() {
 
   PRINTX("Lvl", lvl);
 
-  for (uint8_t i = 0; i < lvl; i++) {             // Each LED to batt level
+  gBatteryIntroLevel = lvl;
+}
+
+void drawBatteryIntro() {
+  if (gBatteryIntroLevel == 0) return;
 
-    uint8_t g = (i * 5 + 2) / NUM_LEDS;           // Red to green
+  uint32_t now = millis();
+  if (now >= BATTERY_INTRO_MS) {
+    gBatteryIntroLevel = 0;
+    return;
+  }
+
+  uint8_t lit = min((uint32_t)gBatteryIntroLevel, 1 + gBatteryIntroLevel * now / BATTERY_INTRO_FILL_MS);
+
+  for (uint8_t i = 0; i < lit; i++) {             // Each LED to batt level
 
-    leds[i].r = 4 - g;
-    leds[i].g = g;
-    leds[i].b = 0;
-    FastLED.setBrightness(255);
-    FastLED.show();
-    delay(500 / NUM_LEDS);
+    uint8_t g = (i * 255) / NUM_LEDS;             // Red to green
+
+    // Blended over the animation that's starting, which stays visible under it
+    nblend(leds[i], CRGB(255 - g, g, 0), BATTERY_INTRO_BLEND);
+  }
+}
+
+// Animation to resume after a warm reset (brown-out, watchdog). It lives
+// outside .bss so the startup code doesn't clear it, and is only trusted
+// when the magic and the check byte match.
+#define RESUME_MAGIC 0x48454152
+
+typedef struct {
+  uint32_t mMagic;
+  uint8_t mPattern;
+  uint8_t mCheck;
+} ResumeState;
+
+ResumeState gResume __attribute__((section(".noinit")));
+
+void saveResumeState() {
+  if (gSequence != gAnimations) return;
+  gResume.mMagic = RESUME_MAGIC;
+  gResume.mPattern = gCurrentPatternNumber;
+  gResume.mCheck = ~gCurrentPatternNumber;
+}
+
+void loadResumeState() {
+  if (gResume.mMagic == RESUME_MAGIC &&
+      gResume.mCheck == (uint8_t)~gResume.mPattern &&
+      gResume.mPattern < ARRAY_SIZE(gAnimations)) {
+    gCurrentPatternNumber = gResume.mPattern;
+    PRINTX("Resuming animation", gCurrentPatternNumber);
   }
-  delay(1500);
 }
 
 /* 
@@ -242,25 +403,51 @@ void showBatteryLevel() {
 #endif 
 
 /**
-   Setup
+   Tasks
 */
 
+#include "TaskScheduler.h"
 
-void setup() {
+#define TASK_RENDER   0
+#define TASK_MIC      2
+
+#define MIC_SAMPLE_PERIOD_US  4000  // analogRead takes ~400us on the M0, so 250Hz
+#define NETWORK_PERIOD_US    50000  // 20Hz
+
+void renderTask();
+void buttonsTask();
+void micTask();
+void networkTask();
+void timersTask();
 
+Task gTasks[] = {
+  // name       function     period (us)           priority                budget (us)
+  {"render",    renderTask,  0,                    TASK_PRIORITY_REALTIME, FRAME_PERIOD_MS * 1000UL},
+  {"buttons",   buttonsTask, 1000,                 2,                      100},
+  {"mic",       micTask,     MIC_SAMPLE_PERIOD_US, 2,                      500},
+  {"timers",    timersTask,  10000,                1,                      500},
 #if USE_IOT
-  setupIoTConnection();
-#else 
-  delay(1000);
-#endif  
+  {"network",   networkTask, NETWORK_PERIOD_US,    0,                      (IOT_LOOP_BLOCKING_TIME + 1) * 1000UL},
+#endif
+};
+
+TaskScheduler tasks(gTasks, ARRAY_SIZE(gTasks));
+
+/**
+   Setup
+*/
+
+
+void setup() {
 
   DEBUG_START(57600)
 
   PRINT("HeartLEDSuit starting...");
 
   // LEDs
-  FastLED.addLeds<NEOPIXEL, LED40_PIN>(leds, 40).setCorrection(TypicalLEDStrip);
-  FastLED.addLeds<NEOPIXEL, LED60_PIN>(leds, 40, 60).setCorrection(TypicalLEDStrip);
+  // Strips are attached to the front buffer, see swapFrameBuffers()
+  FastLED.addLeds<NEOPIXEL, LED40_PIN>(prevLeds, FIRST_2_RINGS_NUM_LEDS).setCorrection(TypicalLEDStrip);
+  FastLED.addLeds<NEOPIXEL, LED60_PIN>(prevLeds, FIRST_2_RINGS_NUM_LEDS, STRIP_SIZE - FIRST_2_RINGS_NUM_LEDS).setCorrection(TypicalLEDStrip);
 
 
 #if USE_2ND_STRIP
@@ -270,10 +457,13 @@ void setup() {
 
   FastLED.setBrightness(DEFAULT_BRIGHTNESS);
 
-  showBatteryLevel();
+  // Power management (FastLED default: 5V, 500mA)
+  powerLimiter.setMaxPower(5, 1000);
+
+  loadResumeState();
 
-  // FastLED power management set at (default: 5V, 500mA)
-  set_max_power_in_volts_and_milliamps(5, 1000);
+  // Drawn over the first frames instead of holding up the boot
+  startBatteryIntro();
 
   // Button
   button.attachClick(onClick);
@@ -291,18 +481,26 @@ void setup() {
   mButton.setClickTicks(600);
 #endif
 
+#if USE_IOT
+  // Only configures the client, the connection comes up from the network task
+  setupIoTConnection();
+#endif
 
+  tasks.begin();
 }
 
-static void delayToSyncFrameRate(uint8_t framesPerSecond) {
-  static uint32_t msprev = 0;
-  uint32_t mscur = millis();
-  uint16_t msdelta = mscur - msprev;
-  uint16_t mstargetdelta = 1000 / framesPerSecond;
-  if (msdelta < mstargetdelta) {
-    delay_at_max_brightness_for_power(mstargetdelta - msdelta);
+// Converts what the animation returned into the period of the current frame, in us
+static uint32_t framePeriodMicros(uint8_t animDelay, uint8_t patternPeriod) {
+  if (animDelay == RANDOM_DELAY) {
+    // TODO Try to sync on actual BPM
+    return beatsin8(gCurrentPatternNumber, 100, 255) * 1000UL;
   }
-  msprev = mscur;
+
+  if (animDelay == SYNCED_DELAY) {
+    animDelay = patternPeriod ? patternPeriod : FRAME_PERIOD_MS;
+  }
+
+  return animDelay * 1000UL;
 }
 
 
@@ -310,176 +508,372 @@ static void delayToSyncFrameRate(uint8_t framesPerSecond) {
    Loop and LED management
 */
 
-#define FIRST_2_RINGS_NUM_LEDS  40
-#define FADING_RATE 5
-void mirrorLedsToSecondaryStrips() {
+#include "OutputMap.h"
+
+#define USE_OUTPUT_MAP (USE_2ND_STRIP || (REVERSE_LEDS && NUM_LEDS < STRIP_SIZE))
 
+#if USE_OUTPUT_MAP
+// Where every physical LED that isn't on the two rings gets its color from.
+// Adding a strip or a mirror is a new line here.
+const OutputSegment gOutputMap[] = {
+  // dest          destStart    srcStart                count                  dir mask              effect
 #if USE_2ND_STRIP
+  {OUTPUT_STRIP2, 0,           0,                      STRIP2_SIZE,            1, LEFT_STRIP_ONLY,  SEGMENT_FX_TWINKLE_RED},
+  {OUTPUT_STRIP2, STRIP2_SIZE, FIRST_2_RINGS_NUM_LEDS, STRIP2_SIZE,            1, RIGHT_STRIP_ONLY, SEGMENT_FX_TWINKLE_BLUE},
+#endif
+#if REVERSE_LEDS && NUM_LEDS < STRIP_SIZE
+  // back of the suit mirrors the front
+  {OUTPUT_FRAME,  NUM_LEDS,    NUM_LEDS - 1,           STRIP_SIZE - NUM_LEDS, -1, SEGMENT_ALWAYS,   SEGMENT_FX_NONE},
+#endif
+};
 
-  // Assumes STRIP2_SIZE is shorter than NUM_LEDS and STRIP_SIZE
-  for (int left = 0, right = STRIP2_SIZE; left < STRIP2_SIZE; left++, right++) {
-
-    // Copy one for one for the left strip
-    leds2[left] = leds[left];
-    // Copy later in the ring for the right strip
-    leds2[right] = leds[FIRST_2_RINGS_NUM_LEDS + left];
-
-    leds2[left].fadeToBlackBy(FADING_RATE);
-    leds2[right].fadeToBlackBy(FADING_RATE);
-
-    //Randomly re-fuel some of the LEDs that are currently lit (1% chance per cycle)
-    //This enhances the twinkling effect.
-    if (leds2[left].r > 10) {
-      if (random8(100) < 1) {
-        //Set the red channel to a value of 80
-        leds2[left].r = 80;
-        //Increase the green channel to 20 - to add to the effect
-        leds2[left].g = 20;
-      }
-    }
-    if (leds2[right].b > 10) {
-      if (random8(100 < 1)) {
-        leds2[right].b = 80;
-        leds2[right].g = 20;
-      }
-    }
+OutputMapper outputMapper(gOutputMap, ARRAY_SIZE(gOutputMap), BLACK_PIXEL);
+#endif
 
+// The refuel effects are seeded with the hash of the frame, so the same
+// frame always maps to the same outputs
+void mapLedsToOutputs(uint32_t frameHash) {
+  uint16_t seed = frameHash ^ (frameHash >> 16);
+#if USE_OUTPUT_MAP
+#if USE_2ND_STRIP
+  outputMapper.apply(leds, leds2, gRenderingSettings, seed);
+#else
+  outputMapper.apply(leds, NULL, gRenderingSettings, seed);
+#endif
+#endif
+}
+
+// FNV-1a over the pixels, chained through hash
+static uint32_t hashPixels(const CRGB* pixels, uint16_t count, uint32_t hash) {
+  const uint8_t* bytes = (const uint8_t*) pixels;
+  for (uint16_t i = 0; i < count * sizeof(CRGB); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
   }
+  return hash;
+}
 
-#endif
+// Hash of everything the strips are mapped from: the outputs only depend
+// on the frame in leds, the rendering settings and the brightness
+static uint32_t hashOutputFrame() {
+  uint8_t brightness = FastLED.getBrightness();
+  uint32_t hash = (2166136261UL ^ brightness) * 16777619UL;
+
+  // Pixels don't matter when the suit is switched off
+  if (brightness == 0) return hash;
+
+  hash = (hash ^ gRenderingSettings) * 16777619UL;
+  return hashPixels(leds, NUM_LEDS, hash);
 }
 
-#define BRIGHTNESS_FALLRATE  40
+uint32_t gShownFrameHash = 0;
+uint32_t gShownFrames = 0;
+uint32_t gSkippedFrames = 0;
 
-void decreaseBrightness() { 
+// Stage times of the last presented frame, in us
+uint32_t gMirrorTime = 0;
+uint32_t gShowTime = 0;
 
-  static uint8_t easeOutVal = 0;
-  static uint8_t easeInVal  = 0;
-  static uint8_t newBrightness    = 0;
+// Shows what the controllers point at, dimmed to the power budget.
+// The estimate is taken once and kept for the stats until the next show.
+void powerLimitedShow() {
+  powerLimiter.measure();
+  powerLimiter.show();
+}
 
-  easeOutVal = ease8InOutQuad(easeInVal);
-  easeInVal++;
+void presentFrame() {
+  // Identical to what's on the strips: skip the mapping, the power math and re-clocking the pixels
+  uint32_t hash = hashOutputFrame();
+  if (hash == gShownFrameHash) {
+    gSkippedFrames++;
+    gMirrorTime = 0;
+    gShowTime = 0;
+    return;
+  }
 
-  newBrightness = lerp8by8(0, 255/*max brightness*/, easeOutVal);
+  uint32_t stageStart = micros();
+  mapLedsToOutputs(hash);
+  gMirrorTime = micros() - stageStart;
 
-  PRINTX("Lowering brightness to:", newBrightness); 
+  stageStart = micros();
+  gShownFrameHash = hash;
+  gShownFrames++;
 
-  FastLED.setBrightness(newBrightness); 
+  swapFrameBuffers();
+  powerLimitedShow();
+
+  gShowTime = micros() - stageStart;
 }
 
-// Experimental: make the animation fade and glitter to a BPM 
-void bpmFilter(uint8_t bpm = 60) { 
+// Period and stats slot of the frame waiting in the back buffer
+uint32_t gNextFramePeriod = FRAME_PERIOD_MS * 1000UL;
+uint8_t gNextFrameSlot = 0;
+
+#if USE_FRAME_STATS
+// Stats of the frame waiting in the back buffer, recorded once it's out
+bool gNextFrameTransitioning = false;
+uint32_t gNextFrameTransitionCost = 0;
+uint32_t gNextFrameSlack = 0;
+#endif
 
-  static int state = 0; 
-  const uint8_t numStates = 4; 
+// Render time of the last frame, in us
+uint32_t gRenderTime = 0;
 
-  static uint8_t prevBeat = 0; 
+// Time from reset to the first animated frame on the strips, in us
+uint32_t gBootToFirstFrame = 0;
 
+#if USE_FRAME_STATS
+// Times a drawing kernel over BENCH_FRAMES frames
+#define BENCH_KERNEL(name, call) { \
+    uint32_t start = micros(); \
+    for (uint8_t f = 0; f < BENCH_FRAMES; f++) call; \
+    Serial.print(name); \
+    Serial.print(" (us/frame): "); \
+    Serial.println((micros() - start) / BENCH_FRAMES); \
+  }
 
-  EVERY_N_SECONDS(10) {state = addmod8(state, 1, numStates); PRINTX("BPM - Moving to state", state);}
+// Times the sound kernels and the circle renderers, the frame being rendered is kept
+void benchKernels() {
+  CRGB frame[NUM_LEDS];
+  memcpy(frame, leds, sizeof(frame));
 
-  EVERY_N_SECONDS(BRIGHTNESS_FALLRATE) { decreaseBrightness(); }
+  SoundAnimation sound;
+  FrameContext ctx = {0, 0, millis()};
+  arena.beginOwner(ARENA_OWNER_DEBUG);
+  sound.init(ctx);
+  if (arena.endOwner()) sound.benchmark();
+  arena.release(ARENA_OWNER_DEBUG);
 
-  uint8_t x = 0; 
+  // Same circle, on the 32x32 grid and on the LED coordinates
+  BENCH_KERNEL("drawCircle r8", drawCircle(16, 16, 8, CRGB::White));
+  BENCH_KERNEL("drawRing r64", drawRing(128, 128, 64, PULSE_RING_WIDTH, CRGB::White));
+  BENCH_KERNEL("drawDisc r64", drawDisc(128, 128, 64, PULSE_RING_WIDTH, CRGB::White));
 
-  if (state == 0) { 
-    x = beat8(bpm); 
-    fadeLightBy(leds, NUM_LEDS, 255-x);
-  } else if (state == 1) { 
-    x = beatsin8(bpm); 
-    fadeLightBy(leds, NUM_LEDS, 255-x);
-  } else if (state == 2) { 
-    x = beat8(bpm); 
+  memcpy(leds, frame, sizeof(frame));
+}
 
-    if (x < prevBeat) { 
-      // beat lowering
-      fadeLightBy(leds, NUM_LEDS, 255-x);
-    }    
-  } else if (state == 3) { 
-    x = beat8(bpm);
-    // Alternatively turn off the first 2 rings then the large ring
-    if (x < prevBeat) { 
-      fadeLightBy(leds, 40, 255-x);
-    }  else { 
-      // rising
-      fadeLightBy(&leds[40], 60, 255-x);
+// Times the render of every animation over BENCH_FRAMES frames. Run it with
+// USE_PALETTE_CACHE on and off to see what the palette cache saves.
+// The animations draw into leds, and some change the strip mask or move the
+// palette along: all of it is put back once they're timed.
+void benchAnimations() {
+  CRGB frame[NUM_LEDS];
+  memcpy(frame, leds, sizeof(frame));
+  uint8_t hue = gHue;
+  uint8_t renderingSettings = gRenderingSettings;
+  PaletteMgr::State paletteState;
+  palettes.save(paletteState);
+
+  uint32_t slot[(ANIMATION_SLOT_SIZE + 3) / 4];
+  for (uint8_t a = 0; a < ARRAY_SIZE(gAnimations); a++) {
+    FrameContext ctx = {gAnimations[a].mArg1, gAnimations[a].mArg2, millis()};
+    AnimationBase* animation = gAnimations[a].mFactory(slot);
+
+    arena.beginOwner(ARENA_OWNER_DEBUG);
+    animation->init(ctx);
+
+    Serial.print("anim ");
+    Serial.print(a);
+    if (arena.endOwner()) {
+      uint32_t start = micros();
+      for (uint8_t f = 0; f < BENCH_FRAMES; f++) {
+        ctx.mNow = millis();
+        animation->render(ctx);
+      }
+      Serial.print(" render (us/frame): ");
+      Serial.println((micros() - start) / BENCH_FRAMES);
+    } else {
+      Serial.println(" skipped, no room in the scratch arena");
     }
+
+    animation->~AnimationBase();
+    arena.release(ARENA_OWNER_DEBUG);
   }
 
-  prevBeat = x;
+#ifdef CPT
+  Serial.print("Gradients decoded since boot: ");
+  Serial.println(palettes.getGradientDecodes());
+#endif
 
-  /*
-  Try to play with the two rings, when going down use the center rings then up use the outer ring 
+  memcpy(leds, frame, sizeof(frame));
+  gHue = hue;
+  gRenderingSettings = renderingSettings;
+  palettes.restore(paletteState);
+}
 
-  or even with the colors: hue = map8( sin8( myValue), HUE_BLUE, HUE_RED);
-  */
+// 'h' dumps the frame time histograms, 't' the task stats, 'l' the layers,
+// 'a' the scratch arena, 'b' times the drawing kernels, 'p' the animations,
+// 'r' resets the histograms
+void handleStatsCommands() {
+  if (!Serial.available()) return;
+
+  switch (Serial.read()) {
+    case 'h': frameStats.dump(); break;
+    case 't': tasks.dump(); break;
+    case 'a': dumpArenaPeaks(); break;
+    case 'b': benchKernels(); break;
+    case 'p': benchAnimations(); break;
+#if USE_LAYERS
+    case 'l': compositor.dump(); break;
+#endif
+    case 'r': frameStats.reset(); PRINT("Frame stats reset"); break;
+  }
 }
+#endif
 
-void loop() {
+void renderTask() {
   random16_add_entropy(random8());
 
-  button.tick();
-#if USE_MEMBRANE_SWITCH
-  mButton.tick();
+  frameScheduler.beginFrame(gNextFramePeriod);
+
+  // Frame N goes out as soon as its deadline is reached, show() blocks until it's out...
+  presentFrame();
+
+  if (gBootToFirstFrame == 0 && gRenderTime != 0) {
+    gBootToFirstFrame = micros();
+    PRINTX("Boot to first frame (us):", gBootToFirstFrame);
+  }
+
+#if USE_FRAME_STATS
+  // Every stage of frame N goes to the slot that rendered it
+  if (gRenderTime != 0) {
+    frameStats.record(gNextFrameSlot, STAGE_ANIMATE, gRenderTime);
+    frameStats.record(gNextFrameSlot, STAGE_MIRROR, gMirrorTime);
+    frameStats.record(gNextFrameSlot, STAGE_SHOW, gShowTime);
+    if (gNextFrameTransitioning) frameStats.record(gNextFrameSlot, STAGE_TRANSITION, gNextFrameTransitionCost);
+    frameStats.record(gNextFrameSlot, STAGE_DELAY, gNextFrameSlack);
+  }
+#endif
+
+  // ...then frame N+1 is rendered into the back buffer
+  AnimationFactory factory = gSequence[gCurrentPatternNumber].mFactory;
+  uint8_t period = gSequence[gCurrentPatternNumber].mFramePeriod;
+  FrameContext ctx = {gSequence[gCurrentPatternNumber].mArg1, gSequence[gCurrentPatternNumber].mArg2, millis()};
+
+  // Context the current animation was rendered with, for transitions
+  static FrameContext prevCtx;
+
+  if (currentAnimationSlot() != gNextFrameSlot || !animations.getCurrent()) {
+    // Strip masks only apply to the animation that asked for them
+    gRenderingSettings = BOTH_STRIPS;
+    saveResumeState();
+
+    // The layers give their scratch memory back first
+#if USE_LAYERS
+    compositor.stop();
+#endif
+    bool firstAnimation = !animations.getCurrent();
+    animations.start(factory, ctx);
+    // NULL when the outgoing animation had to make room in the arena
+    AnimationBase* outgoing = firstAnimation ? NULL : animations.getOutgoing();
+#if USE_LAYERS
+    compositor.start(gSequence[gCurrentPatternNumber].mLayers, gSequence[gCurrentPatternNumber].mLayerCount, ctx);
 #endif
 
-  uint8_t arg1 = gSequence[gCurrentPatternNumber].mArg1;
-  uint8_t arg2 = gSequence[gCurrentPatternNumber].mArg2;
-  Animation animate = gSequence[gCurrentPatternNumber].mPattern;
+    // The drop sequence keeps its hard cuts
+    if (outgoing && gSequence == gAnimations) {
+      transition.start(outgoing, prevCtx, gTransitionType);
+      gTransitionType = addmod8(gTransitionType, 1, TRANSITION_COUNT);
+    } else {
+      transition.cancel();
+    }
+  }
+  gNextFrameSlot = currentAnimationSlot();
+  prevCtx = ctx;
+
+  AnimationBase* animation = animations.getCurrent();
 
-  uint8_t animDelay = animate(arg1, arg2);
+  // Only sample the mic while it's being listened to
+  bool usesMic = factory == makeAnimation<SoundAnimation>;
+#if USE_LAYERS
+  for (uint8_t l = 0; l < gSequence[gCurrentPatternNumber].mLayerCount; l++) {
+    usesMic |= gSequence[gCurrentPatternNumber].mLayers[l].mFactory == makeAnimation<SoundAnimation>;
+  }
+#endif
+  tasks.setEnabled(TASK_MIC, usesMic);
 
-  mirrorLedsToSecondaryStrips();
+  bool transitioning = transition.isRunning();
 
-  //bpmFilter(); 
+  uint32_t stageStart = micros();
+  uint8_t animDelay = transitioning ? transition.render(animation, ctx) : animation->render(ctx);
+  gNextFramePeriod = framePeriodMicros(animDelay, period);
 
-  uint32_t delayTimeDelta = 0; 
+  // Rendering two animations can't cost frames: cut when it doesn't fit
+  // anymore, before the layers and overlays are drawn over the frame
+  if (transitioning && gMirrorTime + gShowTime + micros() - stageStart > gNextFramePeriod) {
+    PRINTX("Transition over the frame budget, cutting. Extra cost (us):", transition.getCost());
+    transition.cancel();
+  }
 
+#if USE_LAYERS
+  compositor.render(ctx.mNow);
+#endif
+  drawBeatOverlay();
+  drawBatteryIntro();
+  gRenderTime = micros() - stageStart;
+  tasks.setNextRun(TASK_RENDER, frameScheduler.getNextDeadline(gNextFramePeriod));
+
+  frameScheduler.endFrame();
+
+#if USE_FRAME_STATS
+  if (arena.getUsed() > gArenaPeaks[gNextFrameSlot]) gArenaPeaks[gNextFrameSlot] = arena.getUsed();
+  gNextFrameTransitioning = transitioning;
+  gNextFrameTransitionCost = transition.getCost();
+  // Slack left until the next frame, shared by the other tasks
+  gNextFrameSlack = gNextFramePeriod > frameScheduler.getWorkTime() ?
+                    gNextFramePeriod - frameScheduler.getWorkTime() : 0;
+#endif
+}
+
+void buttonsTask() {
+  button.tick();
+#if USE_MEMBRANE_SWITCH
+  mButton.tick();
+#endif
+}
+
+void micTask() {
+  sampleMic();
+}
+
+void networkTask() {
 #if USE_IOT
-  uint32_t curr_time = millis(); 
+  uint32_t stageStart = micros();
   loopMQTT(IOT_LOOP_BLOCKING_TIME);
-  delayTimeDelta = millis() - curr_time; 
-#endif  
-
-  uint8_t delayToWait = animDelay; 
-
-  if (animDelay != NO_DELAY) { 
-    if (animDelay == SYNCED_DELAY) { 
-      delayToSyncFrameRate(FRAMES_PER_SECOND);
-    } else { 
-      if (animDelay == RANDOM_DELAY) { 
-        // TODO Try to sync on actual BPM 
-        delayToWait = beatsin8(gCurrentPatternNumber, 100, 255); 
-      } 
-      delayToWait = max(delayToWait-delayTimeDelta, delayTimeDelta); 
-      delay_at_max_brightness_for_power(delayToWait);
-    } 
-  }
+#if USE_FRAME_STATS
+  frameStats.record(gNextFrameSlot, STAGE_MQTT, micros() - stageStart);
+#endif
+#endif
+}
+
+void timersTask() {
 
-  show_at_max_brightness_for_power();
+#if USE_FRAME_STATS
+  handleStatsCommands();
+#endif
 
   // Autoplay (5 mins)
 #if AUTOPLAY_ENABLED
   EVERY_N_SECONDS(SECONDS_PER_ANIMATION) {
 
     // Don't run autoplay on drop squence or first animation
-    if (gSequence != gAnimations || gCurrentPatternNumber == 0) return;
-
-    gCurrentPatternNumber =  addmod8(gCurrentPatternNumber, 1, ARRAY_SIZE(gAnimations));
-    gSequence = gAnimations;
-    PRINTX("AUTOPLAY - Moving to the next animation", gCurrentPatternNumber);
+    if (gSequence == gAnimations && gCurrentPatternNumber != 0) {
+      gCurrentPatternNumber =  addmod8(gCurrentPatternNumber, 1, ARRAY_SIZE(gAnimations));
+      gSequence = gAnimations;
+      PRINTX("AUTOPLAY - Moving to the next animation", gCurrentPatternNumber);
+    }
   }
 #endif
 
-  // blend the current palette to the next
   EVERY_N_MILLISECONDS(40) {
     gHue++;  // slowly cycle the "base color" through the rainbow
-    palettes.blendPalettes();
   }
 
+  // blend the current palette to the next
+  palettes.update(millis());
+
   // slowly change to a new palette
   EVERY_N_SECONDS(SECONDS_PER_PALETTE) {
-    palettes.queueNextPalette();
+    palettes.queueNextPalette(millis());
   };
 
 #ifdef DEBUG
@@ -490,12 +884,48 @@ void loop() {
     Serial.print(getBatteryLevel());
     Serial.print(" || AnimationIndex: ");
     Serial.print(gCurrentPatternNumber);
+    Serial.print(" || Frame work (us): ");
+    Serial.print(frameScheduler.getWorkTime());
+    Serial.print(" || Overruns: ");
+    Serial.print(frameScheduler.getOverruns());
+    Serial.print("/");
+    Serial.print(frameScheduler.getFrameCount());
+    Serial.print(" (max late us: ");
+    Serial.print(frameScheduler.getMaxLateness());
+    Serial.print(")");
     Serial.println("");
+
+    // Serial frame time is render + show, what the blocking driver pays. A
+    // pipelined (DMA) output would only pay for the longest stage.
+    Serial.print("Render (us): ");
+    Serial.print(gRenderTime);
+    Serial.print(" || Show (us): ");
+    Serial.print(gShowTime);
+    Serial.print(" || Serial frame: ");
+    Serial.print(gRenderTime + gShowTime);
+    Serial.print(" || Pipelined frame: ");
+    Serial.print(max(gRenderTime, gShowTime));
+    Serial.print(" || Shown/skipped frames: ");
+    Serial.print(gShownFrames);
+    Serial.print("/");
+    Serial.print(gSkippedFrames);
+#if USE_LAYERS
+    Serial.print(" || Layers (us): ");
+    Serial.print(compositor.getTotalTime());
+#endif
+    Serial.println("");
+
+    powerLimiter.dump();
  
   }
 #endif
 }
 
+void loop() {
+  tasks.runOnce();
 
-
-
+#if USE_IOT
+  // Blocks for longer than a frame, see connectMQTT()
+  if (mqttConnectDue()) connectMQTT();
+#endif
+}
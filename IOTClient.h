@@ -102,37 +102,40 @@ void printWifiStatus() {
 }
 
 
+// Connection state machine, advanced from loopMQTT() so that joining the
+// network never holds up the animations
+typedef enum {
+  NET_NO_SHIELD,
+  NET_WIFI_JOINING,
+  NET_MQTT_CONNECTING,
+  NET_CONNECTED
+} NetState;
+
+#define WIFI_JOIN_TIMEOUT_MS   10000
+// The wait between MQTT connection attempts doubles after every failure,
+// so that a bad network doesn't stall the animations every few seconds
+#define MQTT_RETRY_INTERVAL_MS     5000
+#define MQTT_MAX_RETRY_INTERVAL_MS 80000
+// How long WiFi.begin() waits for the association. 0 returns right away and
+// the join goes on in the driver, polled through WiFi.status()
+#define WIFI_BEGIN_TIMEOUT_MS  0
+
+NetState netState = NET_WIFI_JOINING;
+uint32_t netStateSince = 0;
+bool wifiJoinRequested = false;
+uint32_t mqttRetryInterval = 0;  // 0 to try right away
+
+void setNetState(NetState state) {
+  netState = state;
+  netStateSince = millis();
+}
+
 void setupIoTConnection() { 
 
 #ifdef WINC_EN
   pinMode(WINC_EN, OUTPUT);
   digitalWrite(WINC_EN, HIGH);
 #endif
-  
-  // check for the presence of the shield:
-  if (WiFi.status() == WL_NO_SHIELD) {
-    PRINT("WiFi shield not present");
-    // don't continue:
-    while (true);
-  }
-
-  // attempt to connect to Wifi network:
-  while (WiFi.status() != WL_CONNECTED) {
-    PRINTX("Attempting to connect to SSID: ", ssid);
-    // Connect to WPA/WPA2 network. Change this line if using open or WEP network:
-    status = WiFi.begin(ssid, pass);
-
-    // wait 10 seconds for connection:
-    uint8_t timeout = 10;
-    while (timeout && (WiFi.status() != WL_CONNECTED)) {
-      timeout--;
-      delay(1000);
-    }
-  }
-
-  PRINT("Connected to wifi:");
-  printWifiStatus();
-
 
   brightnessFeed.setCallback(onNewBrightness);
   bpmFeed.setCallback(onNewBPM);
@@ -143,56 +146,106 @@ void setupIoTConnection() {
   mqtt.subscribe(&onoffbuttonFeed);
   mqtt.subscribe(&brightnessFeed);
   mqtt.subscribe(&nextbuttonFeed);
-  
+
+  // The driver's default is to block in begin() until joined, up to a minute
+  WiFi.setTimeout(WIFI_BEGIN_TIMEOUT_MS);
+
+  setNetState(NET_WIFI_JOINING);
 }
 
-// Function to connect and reconnect as necessary to the MQTT server.
-// Should be called in the loop function and it will take care if connecting.
+// One step of bringing up (or back) the WiFi and MQTT connections.
+// WiFi.begin() doesn't wait for the association (see WIFI_BEGIN_TIMEOUT_MS).
+// mqtt.connect() blocks, see connectMQTT below.
 void MQTT_connect() {
-  int8_t ret;
-
-  // attempt to connect to Wifi network:
-  while (WiFi.status() != WL_CONNECTED) {
-    Serial.print("Attempting to connect to SSID: ");
-    Serial.println(ssid);
-    // Connect to WPA/WPA2 network. Change this line if using open or WEP network:
-    status = WiFi.begin(ssid, pass);
-
-    // wait 10 seconds for connection:
-    uint8_t timeout = 10;
-    while (timeout && (WiFi.status() != WL_CONNECTED)) {
-      timeout--;
-      delay(1000);
-    }
+
+  switch (netState) {
+
+    case NET_NO_SHIELD:
+      return;
+
+    case NET_WIFI_JOINING:
+      if (WiFi.status() == WL_NO_SHIELD) {
+        PRINT("WiFi shield not present");
+        setNetState(NET_NO_SHIELD);
+        return;
+      }
+
+      if (WiFi.status() == WL_CONNECTED) {
+        PRINT("Connected to wifi:");
+        printWifiStatus();
+        setNetState(NET_MQTT_CONNECTING);
+        // Try MQTT right away
+        mqttRetryInterval = 0;
+        return;
+      }
+
+      if (!wifiJoinRequested || millis() - netStateSince > WIFI_JOIN_TIMEOUT_MS) {
+        PRINTX("Attempting to connect to SSID: ", ssid);
+        uint32_t start = millis();
+        status = WiFi.begin(ssid, pass);
+        PRINTX("WiFi.begin() (ms):", millis() - start);
+        wifiJoinRequested = true;
+        netStateSince = millis();
+      }
+      return;
+
+    case NET_MQTT_CONNECTING:
+      if (WiFi.status() != WL_CONNECTED) {
+        wifiJoinRequested = false;
+        setNetState(NET_WIFI_JOINING);
+      }
+      return;
+
+    case NET_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        wifiJoinRequested = false;
+        setNetState(NET_WIFI_JOINING);
+      } else if (!mqtt.connected()) {
+        setNetState(NET_MQTT_CONNECTING);
+        mqttRetryInterval = 0;
+      }
+      return;
   }
-  
-  // Stop if already connected.
-  if (mqtt.connected()) {
-    return;
-  } 
-  
+}
+
+bool mqttConnectDue() {
+  return netState == NET_MQTT_CONNECTING && millis() - netStateSince >= mqttRetryInterval;
+}
+
+// mqtt.connect() blocks: DNS lookup, TCP connect and waiting for the
+// CONNACK, up to several seconds on a bad network. That doesn't fit any task
+// budget, so it's called from the main loop outside the scheduler and the
+// frame timeline restarts after it. The time it takes is logged.
+void connectMQTT() {
   PRINT("Connecting to MQTT... ");
+  uint32_t start = millis();
+  int8_t ret = mqtt.connect(); // connect will return 0 for connected
+  PRINTX("mqtt.connect() (ms):", millis() - start);
 
-  while ((ret = mqtt.connect()) != 0) { // connect will return 0 for connected
+  if (ret != 0) {
     PRINTX("Error connecting ", mqtt.connectErrorString(ret));
-    PRINT("Retrying MQTT connection in 5 seconds...");
     mqtt.disconnect();
-    delay(5000);  // wait 5 seconds
+    mqttRetryInterval = constrain(mqttRetryInterval * 2, MQTT_RETRY_INTERVAL_MS, MQTT_MAX_RETRY_INTERVAL_MS);
+    PRINTX("Retrying MQTT connection in (ms):", mqttRetryInterval);
+    netStateSince = millis();
+    return;
   }
 
   PRINT("MQTT Connected!");
-
+  setNetState(NET_CONNECTED);
 }
  
 
 void loopMQTT(uint8_t requestedDelay) { 
 
-  // Ensure the connection to the MQTT server is alive (this will make the first
-  // connection and automatically reconnect when disconnected).  See the MQTT_connect
-  // function definition further below.
+  // Advances the connection to the MQTT server (first connection and
+  // automatic reconnection when disconnected), see MQTT_connect above.
+  // The connection itself is made by connectMQTT()
   MQTT_connect();
 
-  mqtt.processPackets(requestedDelay); 
+  if (netState == NET_CONNECTED) {
+    mqtt.processPackets(requestedDelay); 
+  }
 
 }
 
@@ -0,0 +1,125 @@
+#ifndef OUTPUT_MAP
+#define OUTPUT_MAP
+
+#include <FastLED.h>
+
+/**
+   Declarative logical-to-physical LED mapping.
+
+   Each segment copies a range of the logical frame (leds) to a physical
+   buffer, optionally reversed, masked by gRenderingSettings and followed by
+   a per segment post effect. The table is compiled into a flat gather list
+   so that the per pixel work at output time is a single indexed copy.
+*/
+
+// Physical buffers a segment can write to
+#define OUTPUT_FRAME   0   // the logical frame itself (e.g. back side of the strip)
+#define OUTPUT_STRIP2  1   // leds2
+
+// Segments with this mask are shown whatever the rendering settings
+#define SEGMENT_ALWAYS 0xFF
+
+// Post effects
+#define SEGMENT_FX_NONE          0
+#define SEGMENT_FX_TWINKLE_RED   1  // slight fade, lit pixels randomly re-fueled in red
+#define SEGMENT_FX_TWINKLE_BLUE  2  // slight fade, lit pixels randomly re-fueled in blue
+
+#define FADING_RATE 5
+
+// Upper bound of pixels written by all the segments together
+#define OUTPUT_MAP_CAPACITY 128
+
+typedef struct {
+  uint8_t mDest;       // OUTPUT_FRAME or OUTPUT_STRIP2
+  uint8_t mDestStart;
+  uint8_t mSrcStart;   // first logical pixel, read backwards when mDirection is -1
+  uint8_t mCount;
+  int8_t  mDirection;
+  uint8_t mMask;       // shown when mMask & gRenderingSettings
+  uint8_t mEffect;
+} OutputSegment;
+
+class OutputMapper {
+
+  public:
+
+    // blackPixel is the index of a spare pixel past the end of the frame,
+    // masked segments gather from it
+    OutputMapper(const OutputSegment* segments, uint8_t segmentCount, uint8_t blackPixel) :
+      _segments(segments), _segmentCount(segmentCount), _blackPixel(blackPixel), _compiledFor(0) {}
+
+    // Flattens the table for the given rendering settings
+    void compile(uint8_t renderingSettings) {
+      uint8_t pos = 0;
+
+      for (uint8_t s = 0; s < _segmentCount; s++) {
+        const OutputSegment& seg = _segments[s];
+        bool visible = seg.mMask & renderingSettings;
+
+        for (uint8_t k = 0; k < seg.mCount && pos < OUTPUT_MAP_CAPACITY; k++) {
+          _gather[pos++] = visible ? seg.mSrcStart + k * seg.mDirection : _blackPixel;
+        }
+      }
+
+      if (pos == OUTPUT_MAP_CAPACITY) {
+        PRINT("Output map is larger than OUTPUT_MAP_CAPACITY");
+      }
+
+      _compiledFor = renderingSettings;
+    }
+
+    // seed picks the re-fueled pixels, the same seed maps the same frame to
+    // the same output so that unchanged frames can still be skipped
+    void apply(CRGB* frame, CRGB* strip2, uint8_t renderingSettings, uint16_t seed) {
+      if (renderingSettings != _compiledFor) {
+        compile(renderingSettings);
+      }
+
+      frame[_blackPixel] = CRGB::Black;
+
+      const uint8_t* gather = _gather;
+
+      for (uint8_t s = 0; s < _segmentCount; s++) {
+        const OutputSegment& seg = _segments[s];
+        CRGB* dest = (seg.mDest == OUTPUT_STRIP2 ? strip2 : frame) + seg.mDestStart;
+
+        for (uint8_t k = 0; k < seg.mCount; k++) {
+          dest[k] = frame[*gather++];
+        }
+
+        applyEffect(seg.mEffect, dest, seg.mCount, seed + s);
+      }
+    }
+
+  private:
+
+    static void applyEffect(uint8_t effect, CRGB* dest, uint8_t count, uint16_t seed) {
+      if (effect == SEGMENT_FX_NONE) return;
+
+      fadeToBlackBy(dest, count, FADING_RATE);
+
+      // Re-fuel a lit pixel once in a while, about 1% chance per pixel and frame.
+      // This enhances the twinkling effect. One step of random16's generator
+      // from the seed, so it doesn't change for a given frame.
+      uint16_t roll = seed * 2053 + 13849;
+      if (scale8(roll >> 8, 100) >= count) return;
+
+      CRGB& pixel = dest[scale8(roll, count)];
+
+      if (effect == SEGMENT_FX_TWINKLE_RED && pixel.r > 10) {
+        pixel.r = 80;
+        pixel.g = 20;
+      } else if (effect == SEGMENT_FX_TWINKLE_BLUE && pixel.b > 10) {
+        pixel.b = 80;
+        pixel.g = 20;
+      }
+    }
+
+    const OutputSegment* _segments;
+    uint8_t _segmentCount;
+    uint8_t _blackPixel;
+    uint8_t _compiledFor;
+    uint8_t _gather[OUTPUT_MAP_CAPACITY];
+};
+
+#endif
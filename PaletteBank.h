@@ -0,0 +1,396 @@
+#ifndef PALETTE_BANK
+#define PALETTE_BANK
+
+#include <FastLED.h>
+#include <stddef.h>
+
+/*
+   The suit's own palettes, defined once and packed in flash. Each list is
+   the single source the preprocessor expands into the ids, the packed
+   data and the lookup by id, for PaletteMgr and TwinkleFox alike.
+*/
+
+/**
+   16 color palettes: name, then the 16 colors
+*/
+
+// A mostly (dark) green palette with red berries.
+#define Holly_Green 0x00580c
+#define Holly_Red   0xB00402
+
+// A palette reminiscent of large 'old-school' C9-size tree lights
+// in the five classic colors: red, orange, green, blue, and white.
+#define C9_Red    0xB80400
+#define C9_Orange 0x902C02
+#define C9_Green  0x046002
+#define C9_Blue   0x070758
+#define C9_White  0x606820
+
+// A pure "fairy light" palette with some brightness variations
+#define HALFFAIRY ((CRGB::FairyLight & 0xFEFEFE) / 2)
+#define QUARTERFAIRY ((CRGB::FairyLight & 0xFCFCFC) / 4)
+
+// A cold, icy pale blue palette
+#define Ice_Blue1 0x0C1040
+#define Ice_Blue2 0x182080
+#define Ice_Blue3 0x5080C0
+
+// "CRGB::Gray" is used as white to keep the brightness more uniform.
+#define PALETTE16_LIST(X) \
+  X(RedGreenWhite, \
+    CRGB::Red,   CRGB::Red,   CRGB::Red,   CRGB::Red, \
+    CRGB::Red,   CRGB::Red,   CRGB::Red,   CRGB::Red, \
+    CRGB::Red,   CRGB::Red,   CRGB::Gray,  CRGB::Gray, \
+    CRGB::Green, CRGB::Green, CRGB::Green, CRGB::Green) \
+  X(Holly, \
+    Holly_Green, Holly_Green, Holly_Green, Holly_Green, \
+    Holly_Green, Holly_Green, Holly_Green, Holly_Green, \
+    Holly_Green, Holly_Green, Holly_Green, Holly_Green, \
+    Holly_Green, Holly_Green, Holly_Green, Holly_Red) \
+  X(RedWhite, \
+    CRGB::Red,  CRGB::Red,  CRGB::Red,  CRGB::Red, \
+    CRGB::Gray, CRGB::Gray, CRGB::Gray, CRGB::Gray, \
+    CRGB::Red,  CRGB::Red,  CRGB::Red,  CRGB::Red, \
+    CRGB::Gray, CRGB::Gray, CRGB::Gray, CRGB::Gray) \
+  X(BlueWhite, \
+    CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, \
+    CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, \
+    CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, \
+    CRGB::Blue, CRGB::Gray, CRGB::Gray, CRGB::Gray) \
+  X(FairyLight, \
+    CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, \
+    HALFFAIRY,        HALFFAIRY,        CRGB::FairyLight, CRGB::FairyLight, \
+    QUARTERFAIRY,     QUARTERFAIRY,     CRGB::FairyLight, CRGB::FairyLight, \
+    CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight) \
+  X(Snow, \
+    0x304048, 0x304048, 0x304048, 0x304048, \
+    0x304048, 0x304048, 0x304048, 0x304048, \
+    0x304048, 0x304048, 0x304048, 0x304048, \
+    0x304048, 0x304048, 0x304048, 0xE0F0FF) \
+  X(RetroC9, \
+    C9_Red,    C9_Orange, C9_Red,    C9_Orange, \
+    C9_Orange, C9_Red,    C9_Orange, C9_Red, \
+    C9_Green,  C9_Green,  C9_Green,  C9_Green, \
+    C9_Blue,   C9_Blue,   C9_Blue,   C9_White) \
+  X(Ice, \
+    Ice_Blue1, Ice_Blue1, Ice_Blue1, Ice_Blue1, \
+    Ice_Blue1, Ice_Blue1, Ice_Blue1, Ice_Blue1, \
+    Ice_Blue1, Ice_Blue1, Ice_Blue1, Ice_Blue1, \
+    Ice_Blue2, Ice_Blue2, Ice_Blue2, Ice_Blue3)
+
+#define PALETTE16_ID(name, ...)   PALETTE_##name,
+#define PALETTE16_DATA(name, ...) {__VA_ARGS__},
+
+enum { PALETTE16_LIST(PALETTE16_ID) PALETTE16_COUNT };
+
+// All the same size, the id is the index
+const TProgmemRGBPalette16 gPaletteBank[PALETTE16_COUNT] FL_PROGMEM = {
+  PALETTE16_LIST(PALETTE16_DATA)
+};
+
+inline const TProgmemRGBPalette16& bankPalette(uint8_t id) {
+  return gPaletteBank[id];
+}
+
+
+/**
+   cpt-city gradients, converted for FastLED with gammas (2.6, 2.2, 2.5):
+   name, cpt-city path, then the (index, red, green, blue) stops.
+   The order is the order they're played in.
+*/
+#define GRADIENT_LIST(X) \
+  X(Sunset_Real_gp, /* nd/atmospheric/Sunset_Real */ \
+      0, 120,   0,   0, \
+     22, 179,  22,   0, \
+     51, 255, 104,   0, \
+     85, 167,  22,  18, \
+    135, 100,   0, 103, \
+    198,  16,   0, 130, \
+    255,   0,   0, 160) \
+  X(es_rivendell_15_gp, /* es/rivendell/es_rivendell_15 */ \
+      0,   1,  14,   5, \
+    101,  16,  36,  14, \
+    165,  56,  68,  30, \
+    242, 150, 156,  99, \
+    255, 150, 156,  99) \
+  X(es_ocean_breeze_036_gp, /* es/ocean_breeze/es_ocean_breeze_036 */ \
+      0,   1,   6,   7, \
+     89,   1,  99, 111, \
+    153, 144, 209, 255, \
+    255,   0,  73,  82) \
+  X(rgi_15_gp, /* ds/rgi/rgi_15 */ \
+      0,   4,   1,  31, \
+     31,  55,   1,  16, \
+     63, 197,   3,   7, \
+     95,  59,   2,  17, \
+    127,   6,   2,  34, \
+    159,  39,   6,  33, \
+    191, 112,  13,  32, \
+    223,  56,   9,  35, \
+    255,  22,   6,  38) \
+  X(retro2_16_gp, /* ma/retro2/retro2_16 */ \
+      0, 188, 135,   1, \
+    255,  46,   7,   1) \
+  X(Analogous_1_gp, /* nd/red/Analogous_1 */ \
+      0,   3,   0, 255, \
+     63,  23,   0, 255, \
+    127,  67,   0, 255, \
+    191, 142,   0,  45, \
+    255, 255,   0,   0) \
+  X(es_pinksplash_08_gp, /* es/pink_splash/es_pinksplash_08 */ \
+      0, 126,  11, 255, \
+    127, 197,   1,  22, \
+    175, 210, 157, 172, \
+    221, 157,   3, 112, \
+    255, 157,   3, 112) \
+  X(Coral_reef_gp, /* nd/other/Coral_reef */ \
+      0,  40, 199, 197, \
+     50,  10, 152, 155, \
+     96,   1, 111, 120, \
+     96,  43, 127, 162, \
+    139,  10,  73, 111, \
+    255,   1,  34,  71) \
+  X(es_ocean_breeze_068_gp, /* es/ocean_breeze/es_ocean_breeze_068 */ \
+      0, 100, 156, 153, \
+     51,   1,  99, 137, \
+    101,   1,  68,  84, \
+    104,  35, 142, 168, \
+    178,   0,  63, 117, \
+    255,   1,  10,  10) \
+  X(es_pinksplash_07_gp, /* es/pink_splash/es_pinksplash_07 */ \
+      0, 229,   1,   1, \
+     61, 242,   4,  63, \
+    101, 255,  12, 255, \
+    127, 249,  81, 252, \
+    153, 255,  11, 235, \
+    193, 244,   5,  68, \
+    255, 232,   1,   5) \
+  X(es_vintage_01_gp, /* es/vintage/es_vintage_01 */ \
+      0,   4,   1,   1, \
+     51,  16,   0,   1, \
+     76,  97, 104,   3, \
+    101, 255, 131,  19, \
+    127,  67,   9,   4, \
+    153,  16,   0,   1, \
+    229,   4,   1,   1, \
+    255,   4,   1,   1) \
+  X(departure_gp, /* mjf/departure */ \
+      0,   8,   3,   0, \
+     42,  23,   7,   0, \
+     63,  75,  38,   6, \
+     84, 169,  99,  38, \
+    106, 213, 169, 119, \
+    116, 255, 255, 255, \
+    138, 135, 255, 138, \
+    148,  22, 255,  24, \
+    170,   0, 255,   0, \
+    191,   0, 136,   0, \
+    212,   0,  55,   0, \
+    255,   0,  55,   0) \
+  X(es_landscape_64_gp, /* es/landscape/es_landscape_64 */ \
+      0,   0,   0,   0, \
+     37,   2,  25,   1, \
+     76,  15, 115,   5, \
+    127,  79, 213,   1, \
+    128, 126, 211,  47, \
+    130, 188, 209, 247, \
+    153, 144, 182, 205, \
+    204,  59, 117, 250, \
+    255,   1,  37, 192) \
+  X(es_landscape_33_gp, /* es/landscape/es_landscape_33 */ \
+      0,   1,   5,   0, \
+     19,  32,  23,   1, \
+     38, 161,  55,   1, \
+     63, 229, 144,   1, \
+     66,  39, 142,  74, \
+    255,   1,   4,   1) \
+  X(rainbowsherbet_gp, /* ma/icecream/rainbowsherbet */ \
+      0, 255,  33,   4, \
+     43, 255,  68,  25, \
+     86, 255,   7,  25, \
+    127, 255,  82, 103, \
+    170, 255, 255, 242, \
+    209,  42, 255,  22, \
+    255,  87, 255,  65) \
+  X(gr65_hult_gp, /* hult/gr65_hult */ \
+      0, 247, 176, 247, \
+     48, 255, 136, 255, \
+     89, 220,  29, 226, \
+    160,   7,  82, 178, \
+    216,   1, 124, 109, \
+    255,   1, 124, 109) \
+  X(gr64_hult_gp, /* hult/gr64_hult */ \
+      0,   1, 124, 109, \
+     66,   1,  93,  79, \
+    104,  52,  65,   1, \
+    130, 115, 127,   1, \
+    150,  52,  65,   1, \
+    201,   1,  86,  72, \
+    239,   0,  55,  45, \
+    255,   0,  55,  45) \
+  X(GMT_drywet_gp, /* gmt/GMT_drywet */ \
+      0,  47,  30,   2, \
+     42, 213, 147,  24, \
+     84, 103, 219,  52, \
+    127,   3, 219, 207, \
+    170,   1,  48, 214, \
+    212,   1,   1, 111, \
+    255,   1,   7,  33) \
+  X(ib_jul01_gp, /* ing/xmas/ib_jul01 */ \
+      0, 194,   1,   1, \
+     94,   1,  29,  18, \
+    132,  57, 131,  28, \
+    255, 113,   1,   1) \
+  X(es_vintage_57_gp, /* es/vintage/es_vintage_57 */ \
+      0,   2,   1,   1, \
+     53,  18,   1,   0, \
+    104,  69,  29,   1, \
+    153, 167, 135,  10, \
+    255,  46,  56,   4) \
+  X(ib15_gp, /* ing/general/ib15 */ \
+      0, 113,  91, 147, \
+     72, 157,  88,  78, \
+     89, 208,  85,  33, \
+    107, 255,  29,  11, \
+    141, 137,  31,  39, \
+    255,  59,  33,  89) \
+  X(Fuschia_7_gp, /* ds/fuschia/Fuschia-7 */ \
+      0,  43,   3, 153, \
+     63, 100,   4, 103, \
+    127, 188,   5,  66, \
+    191, 161,  11, 115, \
+    255, 135,  20, 182) \
+  X(es_emerald_dragon_08_gp, /* es/emerald_dragon/es_emerald_dragon_08 */ \
+      0,  97, 255,   1, \
+    101,  47, 133,   1, \
+    178,  13,  43,   1, \
+    255,   2,  10,   1) \
+  X(lava_gp, /* neota/elem/lava */ \
+      0,   0,   0,   0, \
+     46,  18,   0,   0, \
+     96, 113,   0,   0, \
+    108, 142,   3,   1, \
+    119, 175,  17,   1, \
+    146, 213,  44,   2, \
+    174, 255,  82,   4, \
+    188, 255, 115,   4, \
+    202, 255, 156,   4, \
+    218, 255, 203,   4, \
+    234, 255, 255,   4, \
+    244, 255, 255,  71, \
+    255, 255, 255, 255) \
+  X(fire_gp, /* neota/elem/fire */ \
+      0,   1,   1,   0, \
+     76,  32,   5,   0, \
+    146, 192,  24,   0, \
+    197, 220, 105,   5, \
+    240, 252, 255,  31, \
+    250, 252, 255, 111, \
+    255, 255, 255, 255) \
+  X(Colorfull_gp, /* nd/atmospheric/Colorfull */ \
+      0,  10,  85,   5, \
+     25,  29, 109,  18, \
+     60,  59, 138,  42, \
+     93,  83,  99,  52, \
+    106, 110,  66,  64, \
+    109, 123,  49,  65, \
+    113, 139,  35,  66, \
+    116, 192, 117,  98, \
+    124, 255, 255, 137, \
+    168, 100, 180, 155, \
+    255,  22, 121, 174) \
+  X(Magenta_Evening_gp, /* nd/atmospheric/Magenta_Evening */ \
+      0,  71,  27,  39, \
+     31, 130,  11,  51, \
+     63, 213,   2,  64, \
+     70, 232,   1,  66, \
+     76, 252,   1,  69, \
+    108, 123,   2,  51, \
+    255,  46,   9,  35) \
+  X(Pink_Purple_gp, /* nd/atmospheric/Pink_Purple */ \
+      0,  19,   2,  39, \
+     25,  26,   4,  45, \
+     51,  33,   6,  52, \
+     76,  68,  62, 125, \
+    102, 118, 187, 240, \
+    109, 163, 215, 247, \
+    114, 217, 244, 255, \
+    122, 159, 149, 221, \
+    149, 113,  78, 188, \
+    183, 128,  57, 155, \
+    255, 146,  40, 123) \
+  X(es_autumn_19_gp, /* es/autumn/es_autumn_19 */ \
+      0,  26,   1,   1, \
+     51,  67,   4,   1, \
+     84, 118,  14,   1, \
+    104, 137, 152,  52, \
+    112, 113,  65,   1, \
+    122, 133, 149,  59, \
+    124, 137, 152,  52, \
+    135, 113,  65,   1, \
+    142, 139, 154,  46, \
+    163, 113,  13,   1, \
+    204,  55,   3,   1, \
+    249,  17,   1,   1, \
+    255,  17,   1,   1) \
+  X(BlacK_Blue_Magenta_White_gp, /* nd/basic/BlacK_Blue_Magenta_White */ \
+      0,   0,   0,   0, \
+     42,   0,   0,  45, \
+     84,   0,   0, 255, \
+    127,  42,   0, 255, \
+    170, 255,   0, 255, \
+    212, 255,  55, 255, \
+    255, 255, 255, 255) \
+  X(BlacK_Magenta_Red_gp, /* nd/basic/BlacK_Magenta_Red */ \
+      0,   0,   0,   0, \
+     63,  42,   0,  45, \
+    127, 255,   0, 255, \
+    191, 255,   0,  45, \
+    255, 255,   0,   0) \
+  X(BlacK_Red_Magenta_Yellow_gp, /* nd/basic/BlacK_Red_Magenta_Yellow */ \
+      0,   0,   0,   0, \
+     42,  42,   0,   0, \
+     84, 255,   0,   0, \
+    127, 255,   0,  45, \
+    170, 255,   0, 255, \
+    212, 255,  55,  45, \
+    255, 255, 255,   0) \
+  X(Blue_Cyan_Yellow_gp, /* nd/basic/Blue_Cyan_Yellow */ \
+      0,   0,   0, 255, \
+     63,   0,  55, 255, \
+    127,   0, 255, 255, \
+    191,  42, 255,  45, \
+    255, 255, 255,   0)
+
+// Bytes taken by a gradient, from its stops
+template <uint8_t... Bytes>
+struct GradientSize {
+  static const uint16_t value = sizeof...(Bytes);
+};
+
+#define GRADIENT_ID(name, ...)     GRADIENT_##name,
+#define GRADIENT_MEMBER(name, ...) uint8_t name[GradientSize<__VA_ARGS__>::value];
+#define GRADIENT_DATA(name, ...)   {__VA_ARGS__},
+#define GRADIENT_OFFSET(name, ...) offsetof(GradientBank, name),
+
+enum { GRADIENT_LIST(GRADIENT_ID) GRADIENT_COUNT };
+
+// All the gradients back to back, without padding
+struct GradientBank {
+  GRADIENT_LIST(GRADIENT_MEMBER)
+};
+
+const GradientBank gGradientBank FL_PROGMEM = {
+  GRADIENT_LIST(GRADIENT_DATA)
+};
+
+// Where each gradient starts in the bank
+const uint16_t gGradientOffsets[GRADIENT_COUNT] FL_PROGMEM = {
+  GRADIENT_LIST(GRADIENT_OFFSET)
+};
+
+inline TProgmemRGBGradientPalettePtr bankGradient(uint8_t id) {
+  return (TProgmemRGBGradientPalettePtr)&gGradientBank + FL_PGM_READ_WORD_NEAR(&gGradientOffsets[id]);
+}
+
+#endif
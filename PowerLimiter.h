@@ -0,0 +1,97 @@
+#ifndef POWER_LIMITER
+#define POWER_LIMITER
+
+#include <FastLED.h>
+
+// One entry per controller: ring40, ring60, strip2 left, strip2 right
+#define POWER_MAX_STRIPS 4
+
+// Power drawn by the MCU itself, same as FastLED's estimate
+#define POWER_MCU_MW     (25 * 5)
+
+const char* const gPowerStripNames[POWER_MAX_STRIPS] = {"ring40", "ring60", "stripL", "stripR"};
+
+// Brightness limiter working from a power estimate taken once per frame.
+// FastLED's show_at_max_brightness_for_power() walks every pixel of every
+// controller on each call, here the pixels are only read by measure() and
+// the result is reused by show() and by the stats.
+class PowerLimiter {
+
+  public:
+
+    PowerLimiter() : _maxPower(0), _unscaledPower(POWER_MCU_MW), _brightness(0), _stripCount(0) {
+      memset(_stripPower, 0, sizeof(_stripPower));
+    }
+
+    void setMaxPower(uint8_t volts, uint32_t milliamps) {
+      _maxPower = volts * milliamps;
+    }
+
+    // Estimates the full brightness draw of every controller's current pixels
+    void measure() {
+      _stripCount = min(FastLED.count(), POWER_MAX_STRIPS);
+      _unscaledPower = POWER_MCU_MW;
+
+      for (uint8_t i = 0; i < _stripCount; i++) {
+        _stripPower[i] = calculate_unscaled_power_mW(FastLED[i].leds(), FastLED[i].size());
+        _unscaledPower += _stripPower[i];
+      }
+    }
+
+    // Highest brightness up to the requested one that fits the power budget
+    uint8_t limit(uint8_t brightness) {
+      uint32_t requested = (_unscaledPower * brightness) / 256;
+
+      if (_maxPower && requested > _maxPower) {
+        brightness = ((uint32_t)brightness * _maxPower) / requested;
+      }
+      return brightness;
+    }
+
+    // Shows the measured frame at the global brightness, limited
+    void show() {
+      _brightness = limit(FastLED.getBrightness());
+      FastLED.show(_brightness);
+    }
+
+    // Brightness the last frame was shown at
+    uint8_t getBrightness() { return _brightness; }
+
+    uint8_t getStripCount() { return _stripCount; }
+
+    // Draw of a strip at the brightness it was shown at, in mW
+    uint32_t getStripPower(uint8_t strip) {
+      return (_stripPower[strip] * _brightness) / 256;
+    }
+
+    // Total draw including the MCU, in mW
+    uint32_t getPower() {
+      return (_unscaledPower * _brightness) / 256;
+    }
+
+    void dump() {
+      Serial.print("Power (mW): ");
+      for (uint8_t i = 0; i < _stripCount; i++) {
+        Serial.print(gPowerStripNames[i]);
+        Serial.print(" ");
+        Serial.print(getStripPower(i));
+        Serial.print(" || ");
+      }
+      Serial.print("total ");
+      Serial.print(getPower());
+      Serial.print("/");
+      Serial.print(_maxPower);
+      Serial.print(" @ brightness ");
+      Serial.println(_brightness);
+    }
+
+  private:
+
+    uint32_t _maxPower;
+    uint32_t _unscaledPower;
+    uint32_t _stripPower[POWER_MAX_STRIPS];
+    uint8_t _brightness;
+    uint8_t _stripCount;
+};
+
+#endif
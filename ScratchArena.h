@@ -0,0 +1,109 @@
+#ifndef SCRATCH_ARENA
+#define SCRATCH_ARENA
+
+#include <Arduino.h>
+
+// Big enough for the largest users, Life's world and the automata, next
+// to what the animation fading in or the layers and their frames need
+#define ARENA_SIZE        1024
+#define ARENA_MAX_BLOCKS  8
+
+// Owner of short lived allocations made outside the animation slots
+#define ARENA_OWNER_DEBUG 255
+
+// Scratch memory shared by the animations that are on, instead of each
+// animation owning its buffers for the whole run.
+// Owners (animation and layer slots) allocate from init() and get all
+// their blocks back with release() when their animation goes away.
+class ScratchArena {
+
+  public:
+
+    ScratchArena() : _blockCount(0), _used(0), _peak(0), _owner(0), _failed(false) {}
+
+    // Allocations up to the next endOwner() belong to owner
+    void beginOwner(uint8_t owner) {
+      _owner = owner;
+      _failed = false;
+    }
+
+    // False if one of the owner's allocations didn't fit
+    bool endOwner() {
+      return !_failed;
+    }
+
+    // First fit, word aligned. NULL when there's no room left.
+    void* alloc(uint16_t size) {
+      size = (size + 3) & ~3;
+
+      uint16_t offset = 0;
+      uint8_t pos = 0;
+
+      // Blocks are kept sorted by offset, look for the first gap
+      for (; pos < _blockCount; pos++) {
+        if (_blocks[pos].mOffset - offset >= size) break;
+        offset = _blocks[pos].mOffset + _blocks[pos].mSize;
+      }
+
+      if (_blockCount == ARENA_MAX_BLOCKS || offset + size > ARENA_SIZE) {
+        PRINTX("Scratch arena full, can't allocate", size);
+        _failed = true;
+        return NULL;
+      }
+
+      memmove(&_blocks[pos + 1], &_blocks[pos], (_blockCount - pos) * sizeof(Block));
+      _blocks[pos].mOffset = offset;
+      _blocks[pos].mSize = size;
+      _blocks[pos].mOwner = _owner;
+      _blockCount++;
+
+      _used += size;
+      if (_used > _peak) _peak = _used;
+
+      return (uint8_t*)_memory + offset;
+    }
+
+    void release(uint8_t owner) {
+      uint8_t kept = 0;
+      for (uint8_t i = 0; i < _blockCount; i++) {
+        if (_blocks[i].mOwner == owner) {
+          _used -= _blocks[i].mSize;
+        } else {
+          _blocks[kept++] = _blocks[i];
+        }
+      }
+      _blockCount = kept;
+    }
+
+    uint16_t getUsed() { return _used; }
+    uint16_t getPeak() { return _peak; }
+
+    void dump() {
+      Serial.print("Arena (bytes): ");
+      Serial.print(_used);
+      Serial.print("/");
+      Serial.print(ARENA_SIZE);
+      Serial.print(" in ");
+      Serial.print(_blockCount);
+      Serial.print(" blocks || Peak: ");
+      Serial.println(_peak);
+    }
+
+  private:
+
+    typedef struct {
+      uint16_t mOffset;
+      uint16_t mSize;
+      uint8_t mOwner;
+    } Block;
+
+    uint32_t _memory[ARENA_SIZE / 4];
+    Block _blocks[ARENA_MAX_BLOCKS];
+    uint8_t _blockCount;
+    uint16_t _used;
+    uint16_t _peak;
+    uint8_t _owner;
+    bool _failed;
+};
+
+#endif
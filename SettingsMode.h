@@ -44,9 +44,9 @@ public:
         }
       }
 
-      delay_at_max_brightness_for_power(100);
-
-      show_at_max_brightness_for_power();
+      // Shown through powerLimitedShow(), like the animations
+      presentFrame();
+      delay(100);
     }
 
     PRINT("Exiting settings");
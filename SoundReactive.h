@@ -12,330 +12,477 @@ https://github.com/bartlettmic/SparkFun-RGB-LED-Music-Sound-Visualizer-Arduino-C
 #define TOP (NUM_LEDS + 2)                                    // Allow dot to go slightly off scale
 #define PEAK_FALL 4                                          // Rate of peak falling dot
 
-byte
-  peak      = 0,                                              // Used for falling dot
-  dotCount  = 0,                                              // Frame counter for delaying dot-falling speed
-  volCount  = 0;                                              // Frame counter for storing past volume data
-  int
-  vol[SAMPLES],                                               // Collection of prior volume samples
-  lvl       = 10,                                             // Current "dampened" audio level
-  minLvlAvg = 0,                                              // For dynamic adjustment of graph low & high
-  maxLvlAvg = 512;
-  
-  int centerPoint = 15;  
-
-// from VU anims
-  bool bump = false;
-  int bumpCount = 0;
-  float avgBump = 0;
-  float avgBumpTime = 0;
-  float timeSinceLastBump = 0;
-  
-  uint8_t volume = 0;
-  uint8_t lastVolume = 0;
-  float avgVol = 0;
-  float maxVol = 15;
+// Loudest centered mic reading since the last frame, filled by the mic task
+int micPeak = 0;
 
-  bool left = false;
+// Sampled from the mic task, faster than the frame rate so that short peaks aren't missed
+void sampleMic() {
+  int n = abs(analogRead(MIC_PIN) - 512 - DC_OFFSET);        // Center on zero
+  if (n > micPeak) micPeak = n;
+}
 
-  int8_t dotPos = 15; 
-  uint16_t gradient = 1;
-  CRGB rgb[NUM_LEDS] = {(0, 0, 0)};
+int takeMicPeak() {
+  int n = micPeak;
+  micPeak = 0;
+  return n;
+}
 
 #define HALF_LEDS           NUM_LEDS/2
 #define NUM_SOUNDANIMATIONS 5
 
-void updateBumps(int height) {
+/*
+  The M0 has no FPU, the kernels below are fixed point:
+  - volumes and their averages are 8.8 fixed point, within 1/256
+    of a volume step from the float averages they replace
+  - the volume ratio is 0-255 for 0-1, rounded. Squared and raised to 1.5
+    it's within 2/255 of the float powers
+  - bump times are in ms instead of float seconds
+  - sin^2 comes from SIN2_LUT, within 0.5/255
+  - soundPulse frames are within 6/255 of the float ones, paletteDance
+    frames within 3/255
+  tests/host/check_fixed_point.cpp measures all of these.
+*/
+
+// 255 * sin^2(pi * theta / 256) for theta 0-128, the other half is symmetric
+const uint8_t SIN2_LUT[129] = {
+    0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+   10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+   37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+   79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+  127, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+  176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255
+};
+
+// sin^2 over a 256 step period, 0-255
+inline uint8_t sinSquared8(uint8_t theta) {
+  return SIN2_LUT[theta <= 128 ? theta : 256 - theta];
+}
+
+// x / 3, exact for the sum of three 8 bit channels
+inline uint8_t div3(uint16_t x) {
+  return ((uint32_t)x * 683) >> 11;
+}
+
+// ratio^2 for a 0-255 ratio
+inline uint8_t square8(uint8_t ratio) {
+  return scale8(ratio, ratio);
+}
+
+// ratio^1.5 for a 0-255 ratio
+inline uint8_t pow15_8(uint8_t ratio) {
+  return scale8(ratio, sqrt16(ratio << 8));
+}
+
+// Frames timed per kernel by SoundAnimation::benchmark()
+#define BENCH_FRAMES 100
+
+/*
+  arg1 animIndex = animation to play if nextAnimTimeout is 0
+  arg2 nextAnimTimeout = number of seconds to wait before advancing to the next animation (0 to stay)
+*/
+class SoundAnimation : public AnimationBase {
+
+  public:
+
+    void init(const FrameContext& ctx) {
+      _peak      = 0;                                            // Used for falling dot
+      _dotCount  = 0;                                            // Frame counter for delaying dot-falling speed
+      _volCount  = 0;                                            // Frame counter for storing past volume data
+      _vol = (int16_t*)arena.alloc(SAMPLES * sizeof(int16_t));  // Collection of prior volume samples
+      if (!_vol) return;
+      memset(_vol, 0, SAMPLES * sizeof(int16_t));
+      _lvl       = 10;                                           // Current "dampened" audio level
+      _minLvlAvg = 0;                                            // For dynamic adjustment of graph low & high
+      _maxLvlAvg = 512;
+  
+      _centerPoint = 15;  
+
+      // from VU anims
+      _bump = false;
+      _bumpCount = 0;
+      _avgBump = 0;
+      _avgBumpTime = 0;
+      _lastBumpTime = 0;
+  
+      _volume = 0;
+      _lastVolume = 0;
+      _avgVol = 0;
+      _maxVol = 15 << 8;
+      _volumeRatio = 0;
+
+      _left = false;
 
- volume = height; 
+      _dotPos = 15; 
+      _gradient = 1;
 
- if (volume) { 
-  avgVol = (avgVol + volume) / 2.0; 
+      _autoQueueIndex = 0;
+      _lastQueueChange = ctx.mNow;
 
-  if (volume > maxVol) maxVol = volume; 
-  }
+      // Drop what the mic heard before
+      takeMicPeak();
+    }
+
+    uint8_t render(const FrameContext& ctx) {
+      uint8_t animIndex = ctx.mArg1;
+      uint8_t nextAnimTimeout = ctx.mArg2;
 
-  avgVol = (avgVol + volume) / 2.0;
+      uint8_t  i;
+      uint16_t minLvl, maxLvl;
+      int      n, height;
 
+      n = takeMicPeak();                                          // Peak of the readings since the last frame
   
-  if (volume - lastVolume > 10) avgBump = (avgBump + (volume - lastVolume)) / 2.0;
-  bump = (volume - lastVolume > avgBump * 0.9);
-
-  if (gradient > 255) {
-    gradient %= 256;
-    maxVol = (maxVol + volume) / 2.0;
-  }
-
-  if (bump) {
-    // Add overflow protection here 
-    bumpCount++;
-    PRINTX("bump!: ", String(bumpCount));
-    avgBumpTime = (((millis() / 1000.0) - timeSinceLastBump) + avgBumpTime) / 2.0;
-    timeSinceLastBump = millis() / 1000.0;
-    PRINTX("avgtime: ", String(avgBumpTime));
-  }
-
-  gradient++; 
-
-  lastVolume = volume;
-}
+      n = (n <= NOISE) ? 0 : (n - NOISE);                         // Remove noise/hum
+      _lvl = ((_lvl * 7) + n) >> 3;                                 // "Dampened" reading (else looks twitchy)
 
-void bleed(uint8_t point) {
-  for (int i = 1; i < NUM_LEDS; i++) {
-    int sides[] = {point - i, point + i};
-    for (int i = 0; i < 2; i++) {
-      int point = sides[i];
-      if (point < NUM_LEDS - 1 && point > 1) {
-        leds[point].r = float((leds[point - 1].r + leds[point].r + leds[point + 1].r ) / 3.0);
-        leds[point].g = float((leds[point - 1].g + leds[point].g + leds[point + 1].g ) / 3.0);
-        leds[point].b = float((leds[point - 1].b + leds[point].b + leds[point + 1].b ) / 3.0);
+      // Calculate bar height based on dynamic min/max levels (fixed point):
+      height = TOP * (_lvl - _minLvlAvg) / (long)(_maxLvlAvg - _minLvlAvg);
+
+      if (height < 0L)       height = 0;                          // Clip output
+      else if (height > TOP) height = TOP;
+      if (height > _peak)     _peak   = height;                     // Keep 'peak' dot at top
+
+      if (nextAnimTimeout != 0) { 
+        if (ctx.mNow - _lastQueueChange >= nextAnimTimeout * 1000UL) { 
+          _lastQueueChange = ctx.mNow;
+
+          _autoQueueIndex = addmod8(_autoQueueIndex, 1, NUM_SOUNDANIMATIONS); 
+          PRINTX("Move to next animation", _autoQueueIndex);
+
+          // Give palette dance a random starting position 
+          if (_autoQueueIndex == 3) _dotPos = random(NUM_LEDS);
+  
+          // Reset for fresh experience
+          _maxVol = _avgVol;
+          _avgBump = 0;
+          _bumpCount = 0; 
+          _avgBumpTime = 0; 
+         }
+       } else { 
+          PRINT("ALERT: NO SOUND INTERNAL TIMER!!")
+          _autoQueueIndex = animIndex; 
+       }
+
+      // run custom sampling for SparkFun based animations
+      if (_autoQueueIndex > 1) updateBumps(n); 
+
+       if (_autoQueueIndex == 0) {
+        // VU from the base
+        baseVU(height);
+      } else if (_autoQueueIndex == 1) {
+        // random position VU
+        randomVU(height); 
+      } else if (_autoQueueIndex == 2) { 
+        soundPulse();
+      } else if (_autoQueueIndex == 3) { 
+        paletteDance();
+      } else if (_autoQueueIndex == 4) { 
+        glitter();
+      }
+
+      _vol[_volCount] = n;                                          // Save sample for dynamic leveling
+      if (++_volCount >= SAMPLES) _volCount = 0;                    // Advance/rollover sample counter
+
+      // Get volume range of prior frames
+      minLvl = maxLvl = _vol[0];
+      for (i=1; i< SAMPLES; i++) {
+        if (_vol[i] < minLvl)      minLvl = _vol[i];
+        else if (_vol[i] > maxLvl) maxLvl = _vol[i];
       }
+      // minLvl and maxLvl indicate the volume range over prior frames, used
+      // for vertically scaling the output graph (so it looks interesting
+      // regardless of volume level).  If they're too close together though
+      // (e.g. at very low volume levels) the graph becomes super coarse
+      // and 'jumpy'...so keep some minimum distance between them (this
+      // also lets the graph go to zero when no sound is playing):
+      if((maxLvl - minLvl) < TOP) maxLvl = minLvl + TOP;
+      _minLvlAvg = (_minLvlAvg * 63 + minLvl) >> 6;                 // Dampen min/max levels
+      _maxLvlAvg = (_maxLvlAvg * 63 + maxLvl) >> 6;                 // (fake rolling average)
+  
+      return NO_DELAY;
     }
-  }
-}
 
-void soundPulse() {
+    // Time per frame of every kernel, loud and bumping every other frame.
+    // Leaves the animation and leds as they were.
+    void benchmark() {
+      static const char* names[] = {"baseVU", "randomVU", "soundPulse", "paletteDance", "glitter", "paintball", "snake"};
+
+      SoundAnimation saved = *this;
+      CRGB frame[NUM_LEDS];
+      memcpy(frame, leds, sizeof(frame));
+
+      for (uint8_t k = 0; k < ARRAY_SIZE(names); k++) {
+        uint32_t start = micros();
+
+        for (uint8_t f = 0; f < BENCH_FRAMES; f++) {
+          _volume = 200;
+          _volumeRatio = 230;
+          _bump = f & 1;
+
+          switch (k) {
+            case 0: baseVU(TOP / 2); break;
+            case 1: randomVU(TOP / 2); break;
+            case 2: soundPulse(); break;
+            case 3: paletteDance(); break;
+            case 4: glitter(); break;
+            case 5: paintball(); break;
+            case 6: snake(); break;
+          }
+        }
+
+        Serial.print(names[k]);
+        Serial.print(" (us/frame): ");
+        Serial.println((micros() - start) / BENCH_FRAMES);
+      }
 
-  fadeLightBy(leds, NUM_LEDS, 48);
+      *this = saved;
+      memcpy(leds, frame, sizeof(frame));
+    }
 
-  if (bump) gradient += 7;
+  private:
 
-  if (volume > 0) {
+    void updateBumps(int height) {
 
-    CRGB col = ColorFromPalette(palettes.getPalette(), gradient);
-    int start = HALF_LEDS - (HALF_LEDS * (volume / maxVol));
-    int finish = HALF_LEDS + (HALF_LEDS * (volume / maxVol)) + NUM_LEDS % 2;
+      _volume = height;
 
-    for (int i = start; i < finish; i++) {
+      if (_volume) {
+        _avgVol = (_avgVol + (_volume << 8)) >> 1;
 
-      float damp = sin((i - start) * PI / float(finish - start));
-      damp = pow(damp, 2.0);
+        if ((_volume << 8) > _maxVol) _maxVol = _volume << 8;
+      }
+
+      _avgVol = (_avgVol + (_volume << 8)) >> 1;
+
+      int16_t rise = _volume - _lastVolume;
+      if (rise > 10) _avgBump = (_avgBump + (rise << 8)) >> 1;
+      // rise > 0.9 * avgBump
+      _bump = ((int32_t)rise * 2560 > (int32_t)_avgBump * 9);
 
-      CRGB col2 = leds[i];
-      CRGB color;
+      if (_gradient > 255) {
+        _gradient %= 256;
+        _maxVol = (_maxVol + (_volume << 8)) >> 1;
+      }
+
+      if (_bump) {
+        // Add overflow protection here 
+        _bumpCount++;
+        PRINTX("bump!: ", String(_bumpCount));
+        uint32_t now = millis();
+        _avgBumpTime = ((now - _lastBumpTime) + _avgBumpTime) >> 1;
+        _lastBumpTime = now;
+        PRINTX("avgtime (ms): ", String(_avgBumpTime));
+      }
 
-      color.r = col.r * damp * pow(volume / maxVol, 2);
-      color.g  = col.g * damp * pow(volume / maxVol, 2);
-      color.b = col.b * damp * pow(volume / maxVol, 2);
+      _gradient++; 
 
-      float avgCol = (color.r + color.g + color.b) / 3.0;
-      float avgCol2 = (col2.r + col2.g + col2.b) / 3.0;
+      _lastVolume = _volume;
 
-      if (avgCol > avgCol2) leds[i] = color;
+      // volume / maxVol, 0-255 for 0-1, once per frame instead of per pixel
+      if (_maxVol == 0) {
+        _volumeRatio = _volume ? 255 : 0;
+      } else {
+        uint32_t ratio = ((((uint32_t)_volume * 255) << 8) + _maxVol / 2) / _maxVol;
+        _volumeRatio = ratio > 255 ? 255 : ratio;
+      }
     }
 
-  }
-}
+    void bleed(uint8_t point) {
+      for (int i = 1; i < NUM_LEDS; i++) {
+        int sides[] = {point - i, point + i};
+        for (int i = 0; i < 2; i++) {
+          int point = sides[i];
+          if (point < NUM_LEDS - 1 && point > 1) {
+            leds[point].r = div3(leds[point - 1].r + leds[point].r + leds[point + 1].r);
+            leds[point].g = div3(leds[point - 1].g + leds[point].g + leds[point + 1].g);
+            leds[point].b = div3(leds[point - 1].b + leds[point].b + leds[point + 1].b);
+          }
+        }
+      }
+    }
 
-void paintball() {
-
-  if ((millis() / 1000.0) - timeSinceLastBump > avgBumpTime * 2.0) fadeToBlackBy(leds, NUM_LEDS, 4);
-  bleed(dotPos);
-  int fadeAmount = map(pow(volume / maxVol, 2.0) * 100, 0, 100, 0, 255);
-  if (bump) {
-    randomSeed(micros());
-    dotPos = random(0, NUM_LEDS - 1);
-    CRGB dotCol = ColorFromPalette(palettes.getPalette(), random(0, 255));
-    leds[dotPos] = dotCol;
-    leds[dotPos].nscale8_video(fadeAmount);
-    blur1d(leds, NUM_LEDS, 74);
-  }
-}
+    void soundPulse() {
 
-void paletteDance() { 
-
-  if (bump) left = !left;
-
-  if (volume > avgVol) {
-    for (int i = 0; i < NUM_LEDS; i++) {
-      float sinVal = abs(sin((i + dotPos) * (PI / float(NUM_LEDS / 1.25))));
-      sinVal *= sinVal;
-      sinVal *= volume / maxVol;
-
-      unsigned int val = 256
-      * (float(i + map(dotPos, -1 * (NUM_LEDS - 1), NUM_LEDS - 1, 0, NUM_LEDS - 1))
-        / float(NUM_LEDS))
-      + (gHue);
-      val %= 256;
-      CRGB col = ColorFromPalette(palettes.getPalette(), val);
-      leds[i].r = col.r * sinVal;
-      leds[i].g = col.g * sinVal;
-      leds[i].b = col.b * sinVal;
+      fadeLightBy(leds, NUM_LEDS, 48);
+
+      if (_bump) _gradient += 7;
+
+      if (_volume > 0) {
+
+        CRGB col = palettes.colorAt(_gradient);
+        // From the volumes rather than the rounded ratio, a pixel more or
+        // less moves the whole pulse
+        int halfWidth = min(((uint32_t)HALF_LEDS * _volume << 8) / _maxVol, HALF_LEDS);
+        int start = HALF_LEDS - halfWidth;
+        int finish = HALF_LEDS + halfWidth + NUM_LEDS % 2;
+        uint8_t loudness = square8(_volumeRatio);
+
+        for (int i = start; i < finish; i++) {
+
+          uint8_t damp = scale8(sinSquared8(((i - start) << 8) / (finish - start)), loudness);
+
+          CRGB color = col;
+          color.nscale8(damp);
+
+          // Brighter than what's there, comparing the sums is comparing the averages
+          if (color.r + color.g + color.b > leds[i].r + leds[i].g + leds[i].b) leds[i] = color;
+        }
+
+      }
     }
-    dotPos += (left) ? -1 : 1;
-  }
-  else  fadeLightBy(leds, NUM_LEDS, 16);
 
-  if (dotPos < 0) dotPos = NUM_LEDS - NUM_LEDS / 6;
-  else if (dotPos >= NUM_LEDS - NUM_LEDS / 6)  dotPos = 0;
-}
+    void paintball() {
+
+      if (millis() - _lastBumpTime > _avgBumpTime * 2) fadeToBlackBy(leds, NUM_LEDS, 4);
+      bleed(_dotPos);
+      uint8_t fadeAmount = square8(_volumeRatio);
+      if (_bump) {
+        randomSeed(micros());
+        _dotPos = random(0, NUM_LEDS - 1);
+        CRGB dotCol = palettes.colorAt(random(0, 255));
+        leds[_dotPos] = dotCol;
+        leds[_dotPos].nscale8_video(fadeAmount);
+        blur1d(leds, NUM_LEDS, 74);
+      }
+    }
 
-void glitter() {
-
-  gradient += 4;
-  for (int i = 0; i < NUM_LEDS; i++) {
-    unsigned int val = 256.0 *
-    (float(i) / float(NUM_LEDS))
-    + (gradient);
-    val %= 255;
-    CRGB  col = ColorFromPalette(palettes.getPalette(), val);
-    leds[i].r = col.r / 6.0,
-    leds[i].g = col.g / 6.0,
-    leds[i].b = col.b / 6.0;
-  }
-  if (bump) {
-    randomSeed(micros());
-    dotPos = random(NUM_LEDS - 1);
-    leds[dotPos].r = 255.0 * pow(volume / maxVol, 2.0),
-    leds[dotPos].g = 255.0 * pow(volume / maxVol, 2.0),
-    leds[dotPos].b = 255.0 * pow(volume / maxVol, 2.0);
-  }
-  bleed(dotPos);
-}
+    void paletteDance() { 
 
-void snake() {
+      if (_bump) _left = !_left;
 
-  if (bump) {
-    gradient += 4;
-    left = !left;
-  }
+      if ((_volume << 8) > _avgVol) {
+        int offset = map(_dotPos, -1 * (NUM_LEDS - 1), NUM_LEDS - 1, 0, NUM_LEDS - 1);
 
-  fadeLightBy(leds, NUM_LEDS, 4);
+        for (int i = 0; i < NUM_LEDS; i++) {
+          // sin^2((i + dotPos) * pi / (NUM_LEDS / 1.25)), 320 = 256 * 1.25
+          uint8_t sinVal = sinSquared8(((i + _dotPos) * 320) / NUM_LEDS);
+          sinVal = scale8(sinVal, _volumeRatio);
 
-  CRGB col = ColorFromPalette(palettes.getPalette(), gradient);
+          uint8_t val = (256 * (i + offset)) / NUM_LEDS + gHue;
+          CRGB col = palettes.colorAt(val);
+          leds[i] = col.nscale8(sinVal);
+        }
+        _dotPos += (_left) ? -1 : 1;
+      }
+      else  fadeLightBy(leds, NUM_LEDS, 16);
 
-  if (volume > 0) {
+      if (_dotPos < 0) _dotPos = NUM_LEDS - NUM_LEDS / 6;
+      else if (_dotPos >= NUM_LEDS - NUM_LEDS / 6)  _dotPos = 0;
+    }
 
-    int fadeAmount = map(pow(volume / maxVol, 1.5) * 100, 0, 100, 0, 255);
-    leds[dotPos] = col;
-    leds[dotPos].nscale8_video(fadeAmount);
+    void glitter() {
+
+      _gradient += 4;
+      for (int i = 0; i < NUM_LEDS; i++) {
+        unsigned int val = (256 * i) / NUM_LEDS + _gradient;
+        val %= 255;
+        CRGB  col = palettes.colorAt(val);
+        // c / 6, exact for 0-255
+        leds[i].r = (col.r * 171) >> 10;
+        leds[i].g = (col.g * 171) >> 10;
+        leds[i].b = (col.b * 171) >> 10;
+      }
+      if (_bump) {
+        randomSeed(micros());
+        _dotPos = random(NUM_LEDS - 1);
+        uint8_t level = square8(_volumeRatio);
+        leds[_dotPos].setRGB(level, level, level);
+      }
+      bleed(_dotPos);
+    }
 
-    if (avgBumpTime < 0.15)                                               dotPos += (left) ? -1 : 1;
-    else if (avgBumpTime >= 0.15 && avgBumpTime < 0.5 && gradient % 2 == 0)   dotPos += (left) ? -1 : 1;
-    else if (avgBumpTime >= 0.5 && avgBumpTime < 1.0 && gradient % 3 == 0)    dotPos += (left) ? -1 : 1;
-    else if (gradient % 4 == 0)                                       dotPos += (left) ? -1 : 1;
-  }
+    void snake() {
 
-  if (dotPos < 0) dotPos = NUM_LEDS - 1;
-  else if (dotPos >= NUM_LEDS)  dotPos = 0;
-}
+      if (_bump) {
+        _gradient += 4;
+        _left = !_left;
+      }
+
+      fadeLightBy(leds, NUM_LEDS, 4);
+
+      CRGB col = palettes.colorAt(_gradient);
+
+      if (_volume > 0) {
 
+        uint8_t fadeAmount = pow15_8(_volumeRatio);
+        leds[_dotPos] = col;
+        leds[_dotPos].nscale8_video(fadeAmount);
 
-void randomVU(int height) {
+        if (_avgBumpTime < 150)                                               _dotPos += (_left) ? -1 : 1;
+        else if (_avgBumpTime >= 150 && _avgBumpTime < 500 && _gradient % 2 == 0)   _dotPos += (_left) ? -1 : 1;
+        else if (_avgBumpTime >= 500 && _avgBumpTime < 1000 && _gradient % 3 == 0)  _dotPos += (_left) ? -1 : 1;
+        else if (_gradient % 4 == 0)                                       _dotPos += (_left) ? -1 : 1;
+      }
 
-  for (int i = 0; i < NUM_LEDS; i++) {
-    int distanceFromCenter = abs(centerPoint - i);
-    if (distanceFromCenter >= (height/2)) {
-      leds[i].setRGB(0, 0, 0);
-    } else {
-        //leds[i].setRGB(255, 0, 0);
-      leds[i] = ColorFromPalette(palettes.getPalette(), 
-        90 + map(distanceFromCenter, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
+      if (_dotPos < 0) _dotPos = NUM_LEDS - 1;
+      else if (_dotPos >= NUM_LEDS)  _dotPos = 0;
     }
-  }
-    //move center point randomly
-  if ((height == 0) && (random(2) == 1)) {
-    centerPoint = random(NUM_LEDS);
-  }
-}
 
-void baseVU(int height) { 
-  // Color pixels based on rainbow gradient
-  for (int i = 0; i < NUM_LEDS; i++) {
-    if (i >= height)  leds[i].setRGB(0, 0, 0);
-    else leds[i] = ColorFromPalette(palettes.getPalette(), 
-      90 + map(i, 0, NUM_LEDS-1, 0, 255), 100, LINEARBLEND);
-  }
-
-  if (peak > 0 && peak <= NUM_LEDS-1) leds[peak] = CHSV(map(peak,0,NUM_LEDS-1,30,150), 255, 255);
-
-    // Every few frames, make the peak pixel drop by 1:
-  if (++dotCount >= PEAK_FALL) {                            // fall rate 
-    if(peak > 0) peak--;
-    dotCount = 0;
-  }
-}
 
-/*
-  animIndex = animation to play if nextAnimTimeout is 0
-  nextAnimTimeout = number of seconds to wait before advancing to the next animation (0 to stay)
-*/
-uint8_t soundAnimate(uint8_t animIndex, uint8_t nextAnimTimeout = 0) {
+    void randomVU(int height) {
 
-  uint8_t  i;
-  uint16_t minLvl, maxLvl;
-  int      n, height;
+      for (int i = 0; i < NUM_LEDS; i++) {
+        int distanceFromCenter = abs(_centerPoint - i);
+        if (distanceFromCenter >= (height/2)) {
+          leds[i].setRGB(0, 0, 0);
+        } else {
+            //leds[i].setRGB(255, 0, 0);
+          leds[i] = palettes.colorAt(
+            90 + map(distanceFromCenter, 0, NUM_LEDS-1, 0, 255), 100);
+        }
+      }
+        //move center point randomly
+      if ((height == 0) && (random(2) == 1)) {
+        _centerPoint = random(NUM_LEDS);
+      }
+    }
 
-  n = analogRead(MIC_PIN);                                    // Raw reading from mic
-  n = abs(n - 512 - DC_OFFSET);                               // Center on zero
-  
-  n = (n <= NOISE) ? 0 : (n - NOISE);                         // Remove noise/hum
-  lvl = ((lvl * 7) + n) >> 3;                                 // "Dampened" reading (else looks twitchy)
-
-  // Calculate bar height based on dynamic min/max levels (fixed point):
-  height = TOP * (lvl - minLvlAvg) / (long)(maxLvlAvg - minLvlAvg);
-
-  if (height < 0L)       height = 0;                          // Clip output
-  else if (height > TOP) height = TOP;
-  if (height > peak)     peak   = height;                     // Keep 'peak' dot at top
-
-  static uint8_t autoQueueIndex = 0;
-
-  if (nextAnimTimeout != 0) { 
-    EVERY_N_SECONDS(nextAnimTimeout) { 
-
-      autoQueueIndex = addmod8(autoQueueIndex, 1, NUM_SOUNDANIMATIONS); 
-      PRINTX("Move to next animation", autoQueueIndex);
-
-      // Give palette dance a random starting position 
-      if (autoQueueIndex == 3) dotPos = random(NUM_LEDS);
-      
-      // Reset for fresh experience
-      maxVol = avgVol; 
-      avgBump = 0;
-      bumpCount = 0; 
-      avgBumpTime = 0; 
-     }
-   } else { 
-      PRINT("ALERT: NO SOUND INTERNAL TIMER!!")
-      autoQueueIndex = animIndex; 
-   }
-
-  // run custom sampling for SparkFun based animations
-  if (autoQueueIndex > 1) updateBumps(n); 
-
-   if (autoQueueIndex == 0) {
-    // VU from the base
-    baseVU(height);
-  } else if (autoQueueIndex == 1) {
-    // random position VU
-    randomVU(height); 
-  } else if (autoQueueIndex == 2) { 
-    soundPulse();
-  } else if (autoQueueIndex == 3) { 
-    paletteDance();
-  } else if (autoQueueIndex == 4) { 
-    glitter();
-  }
-
-  vol[volCount] = n;                                          // Save sample for dynamic leveling
-  if (++volCount >= SAMPLES) volCount = 0;                    // Advance/rollover sample counter
-
-  // Get volume range of prior frames
-  minLvl = maxLvl = vol[0];
-  for (i=1; i< SAMPLES; i++) {
-    if (vol[i] < minLvl)      minLvl = vol[i];
-    else if (vol[i] > maxLvl) maxLvl = vol[i];
-  }
-  // minLvl and maxLvl indicate the volume range over prior frames, used
-  // for vertically scaling the output graph (so it looks interesting
-  // regardless of volume level).  If they're too close together though
-  // (e.g. at very low volume levels) the graph becomes super coarse
-  // and 'jumpy'...so keep some minimum distance between them (this
-  // also lets the graph go to zero when no sound is playing):
-  if((maxLvl - minLvl) < TOP) maxLvl = minLvl + TOP;
-  minLvlAvg = (minLvlAvg * 63 + minLvl) >> 6;                 // Dampen min/max levels
-  maxLvlAvg = (maxLvlAvg * 63 + maxLvl) >> 6;                 // (fake rolling average)
-  
-  return NO_DELAY;
-}
+    void baseVU(int height) { 
+      // Color pixels based on rainbow gradient
+      for (int i = 0; i < NUM_LEDS; i++) {
+        if (i >= height)  leds[i].setRGB(0, 0, 0);
+        else leds[i] = palettes.colorAt(
+          90 + map(i, 0, NUM_LEDS-1, 0, 255), 100);
+      }
+
+      if (_peak > 0 && _peak <= NUM_LEDS-1) leds[_peak] = CHSV(map(_peak,0,NUM_LEDS-1,30,150), 255, 255);
+
+        // Every few frames, make the peak pixel drop by 1:
+      if (++_dotCount >= PEAK_FALL) {                            // fall rate 
+        if(_peak > 0) _peak--;
+        _dotCount = 0;
+      }
+    }
+
+    byte _peak;
+    byte _dotCount;
+    byte _volCount;
+    int16_t* _vol;                                              // SAMPLES readings, in the scratch arena
+    int _lvl;
+    int _minLvlAvg;
+    int _maxLvlAvg;
+
+    int _centerPoint;
+
+    bool _bump;
+    int _bumpCount;
+    uint16_t _avgBump;                                          // 8.8
+    uint32_t _avgBumpTime;                                      // ms
+    uint32_t _lastBumpTime;
+
+    uint8_t _volume;
+    uint8_t _lastVolume;
+    uint16_t _avgVol;                                           // 8.8
+    uint16_t _maxVol;                                           // 8.8
+    uint8_t _volumeRatio;                                       // volume / maxVol, 0-255
+
+    bool _left;
+
+    int8_t _dotPos;
+    uint16_t _gradient;
+
+    uint8_t _autoQueueIndex;
+    uint32_t _lastQueueChange;
+};
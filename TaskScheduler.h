@@ -0,0 +1,145 @@
+#ifndef TASK_SCHEDULER
+#define TASK_SCHEDULER
+
+#include <Arduino.h>
+
+typedef void (*TaskFunction)();
+
+// Realtime tasks (the renderer) are protected by the budgets of the others
+#define TASK_PRIORITY_REALTIME 3
+
+typedef struct {
+  const char* mName;
+  TaskFunction mRun;
+  uint32_t mPeriod;     // us, 0 for tasks that schedule themselves with setNextRun()
+  uint8_t mPriority;    // the highest priority due task runs first
+  uint32_t mBudget;     // us the task is expected to run for
+
+  // Runtime state and statistics, zero initialized
+  bool mDisabled;
+  uint32_t mNextRun;
+  uint32_t mRuns;
+  uint32_t mTotalTime;
+  uint32_t mMaxTime;
+  uint32_t mMaxLateness;
+  uint32_t mOverBudget;
+} Task;
+
+// Cooperative scheduler for the main loop.
+// A due task only starts when its budget ends before the next realtime
+// deadline, so that slow tasks (network) fill the slack between frames
+// instead of delaying them. A task that's been waiting for more than a full
+// period goes ahead of the other non-realtime ones, but still has to fit.
+// Budgets have to fit the slack between frames, calls that block for longer
+// don't belong in a task.
+class TaskScheduler {
+
+  public:
+
+    TaskScheduler(Task* tasks, uint8_t taskCount) : _tasks(tasks), _taskCount(taskCount) {}
+
+    void begin() {
+      uint32_t now = micros();
+      for (uint8_t i = 0; i < _taskCount; i++) {
+        _tasks[i].mNextRun = now;
+      }
+    }
+
+    void setNextRun(uint8_t index, uint32_t when) {
+      _tasks[index].mNextRun = when;
+    }
+
+    void setEnabled(uint8_t index, bool enabled) {
+      if (_tasks[index].mDisabled == enabled) {
+        _tasks[index].mDisabled = !enabled;
+        _tasks[index].mNextRun = micros();
+      }
+    }
+
+    void runOnce() {
+      uint32_t now = micros();
+
+      // Highest ranked due task that fits before the next realtime run: a
+      // task that doesn't fit lets the smaller ones behind it go first
+      int8_t next = -1;
+      uint8_t nextRank = 0;
+      for (uint8_t i = 0; i < _taskCount; i++) {
+        Task& task = _tasks[i];
+        if (task.mDisabled || (int32_t)(now - task.mNextRun) < 0) continue;
+        uint8_t taskRank = rank(task, now);
+        if (next >= 0 && taskRank <= nextRank) continue;
+        if (canStart(task, now)) {
+          next = i;
+          nextRank = taskRank;
+        }
+      }
+
+      if (next < 0) {
+        yield();
+        return;
+      }
+
+      Task& task = _tasks[next];
+
+      uint32_t lateness = now - task.mNextRun;
+      if (lateness > task.mMaxLateness) task.mMaxLateness = lateness;
+
+      if (task.mPeriod) {
+        task.mNextRun += task.mPeriod;
+        // Too far behind: skip the missed runs rather than bursting them
+        if ((int32_t)(now - task.mNextRun) > 0) task.mNextRun = now + task.mPeriod;
+      }
+
+      task.mRun();
+
+      uint32_t runTime = micros() - now;
+      task.mRuns++;
+      task.mTotalTime += runTime;
+      if (runTime > task.mMaxTime) task.mMaxTime = runTime;
+      if (runTime > task.mBudget) task.mOverBudget++;
+    }
+
+    // One line per task: runs avg max (us) over budget, max lateness (us)
+    void dump() {
+      Serial.println("task runs avg max overbudget maxlate (us)");
+      for (uint8_t i = 0; i < _taskCount; i++) {
+        Task& task = _tasks[i];
+        Serial.print(task.mName);
+        Serial.print(" ");
+        Serial.print(task.mRuns);
+        Serial.print(" ");
+        Serial.print(task.mRuns ? task.mTotalTime / task.mRuns : 0);
+        Serial.print(" ");
+        Serial.print(task.mMaxTime);
+        Serial.print(" ");
+        Serial.print(task.mOverBudget);
+        Serial.print(" ");
+        Serial.println(task.mMaxLateness);
+      }
+    }
+
+  private:
+
+    // Priority first, then starving tasks. Realtime tasks have the highest
+    // priority so they stay ahead of any starving one.
+    uint8_t rank(const Task& task, uint32_t now) {
+      bool starving = task.mPeriod && now - task.mNextRun > task.mPeriod;
+      return (task.mPriority << 1) | starving;
+    }
+
+    bool canStart(const Task& task, uint32_t now) {
+      if (task.mPriority >= TASK_PRIORITY_REALTIME) return true;
+
+      for (uint8_t i = 0; i < _taskCount; i++) {
+        const Task& other = _tasks[i];
+        if (other.mDisabled || other.mPriority < TASK_PRIORITY_REALTIME) continue;
+        if ((int32_t)(other.mNextRun - (now + task.mBudget)) < 0) return false;
+      }
+      return true;
+    }
+
+    Task* _tasks;
+    uint8_t _taskCount;
+};
+
+#endif
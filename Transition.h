@@ -0,0 +1,132 @@
+#ifndef TRANSITION
+#define TRANSITION
+
+#include <FastLED.h>
+
+/**
+   Crossfades between two animations.
+
+   While a transition runs the outgoing and the incoming animations each
+   render into their own buffer, so that their fades and trails stay their
+   own, and the frame is blended from both.
+*/
+
+#define TRANSITION_FADE             0  // whole frame at once
+#define TRANSITION_FIBONACCI_WIPE   1  // along the Fibonacci order, center first
+#define TRANSITION_SWEEP_WIPE       2  // around the center, like a clock hand
+#define TRANSITION_COUNT            3
+
+#define TRANSITION_MS             800
+
+// Width of the soft edge of the wipes, in 1/256 of the wipe
+#define TRANSITION_EDGE            48
+
+class Transition {
+
+  public:
+
+    Transition() : _outgoing(NULL), _start(0), _duration(0), _type(TRANSITION_FADE), _cost(0) {}
+
+    // Starts blending from the animation that rendered the frame in leds,
+    // which must stay alive until the transition is over
+    void start(AnimationBase* outgoing, const FrameContext& outgoingCtx, uint8_t type, uint16_t duration = TRANSITION_MS) {
+      _outgoing = outgoing;
+      _outgoingCtx = outgoingCtx;
+      _type = type;
+      _duration = duration;
+      _start = millis();
+
+      // Both sides carry on from the last frame, as a cut would
+      memcpy(_outLeds, leds, sizeof(_outLeds));
+      memcpy(_inLeds, leds, sizeof(_inLeds));
+    }
+
+    bool isRunning() {
+      if (_outgoing && millis() - _start >= _duration) _outgoing = NULL;
+      return _outgoing != NULL;
+    }
+
+    // Ends the transition on the incoming animation
+    void cancel() {
+      if (_outgoing) memcpy(leds, _inLeds, NUM_LEDS * sizeof(CRGB));
+      _outgoing = NULL;
+    }
+
+    // Renders both animations and blends them into leds, returns the
+    // incoming animation's delay
+    uint8_t render(AnimationBase* incoming, const FrameContext& ctx) {
+      CRGB* frame = leds;
+      uint32_t stageStart = micros();
+
+      leds = _outLeds;
+      _outgoingCtx.mNow = ctx.mNow;
+      _outgoing->render(_outgoingCtx);
+      uint32_t outgoingTime = micros() - stageStart;
+
+      leds = _inLeds;
+      uint8_t animDelay = incoming->render(ctx);
+
+      leds = frame;
+
+      stageStart = micros();
+      blendFrame(progress());
+      _cost = outgoingTime + micros() - stageStart;
+
+      return animDelay;
+    }
+
+    // Time the last transition frame added on top of the incoming animation, in us
+    uint32_t getCost() { return _cost; }
+
+  private:
+
+    uint8_t progress() {
+      uint32_t elapsed = millis() - _start;
+      if (elapsed >= _duration) return 255;
+      return (elapsed * 255) / _duration;
+    }
+
+    // Position of a pixel along the wipe, 0 goes first
+    uint8_t wipeKey(uint8_t i) {
+      // The spiral goes out as regularly as its index, so a wipe by the
+      // radius would look the same as this one
+      if (_type == TRANSITION_FIBONACCI_WIPE) return ledGeometry.mFibIndex[i] * 255 / (NUM_LEDS - 1);
+      return ledGeometry.mAngle[i];
+    }
+
+    void blendFrame(uint8_t progress) {
+      if (_type == TRANSITION_FADE) {
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+          leds[i] = blend(_outLeds[i], _inLeds[i], progress);
+        }
+        return;
+      }
+
+      // The edge starts before the first pixel and ends after the last one
+      int16_t front = ((int16_t)progress * (256 + TRANSITION_EDGE)) / 256;
+
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        int16_t amount = front - wipeKey(i);
+
+        if (amount <= 0) {
+          leds[i] = _outLeds[i];
+        } else if (amount >= TRANSITION_EDGE) {
+          leds[i] = _inLeds[i];
+        } else {
+          leds[i] = blend(_outLeds[i], _inLeds[i], (amount * 255) / TRANSITION_EDGE);
+        }
+      }
+    }
+
+    AnimationBase* _outgoing;
+    FrameContext _outgoingCtx;
+    uint32_t _start;
+    uint16_t _duration;
+    uint8_t _type;
+    uint32_t _cost;
+
+    CRGB _outLeds[STRIP_SIZE + 1];
+    CRGB _inLeds[STRIP_SIZE + 1];
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef HOST_CHECK
+#define HOST_CHECK
+
+/**
+   Shared by the host checks: the sketch built for the host against the
+   stand-ins in stub/, a clock and pass/fail reporting.
+
+   The system headers come first so that a check can reach into the
+   private members of the sketch's classes with #define private public.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include <new>
+
+int gFailures = 0;
+
+inline double hostNanos() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Prints a measured error next to the bound the code claims
+void expectWithin(const char* what, double measured, double bound) {
+  bool ok = measured <= bound + 1e-9;
+  printf("%-44s %8.4f  (bound %.4f)%s\n", what, measured, bound, ok ? "" : "  FAIL");
+  if (!ok) gFailures++;
+}
+
+void expectEqual(const char* what, long measured, long expected) {
+  bool ok = measured == expected;
+  printf("%-44s %8ld  (expected %ld)%s\n", what, measured, expected, ok ? "" : "  FAIL");
+  if (!ok) gFailures++;
+}
+
+// Host time of one run of code, averaged over frames runs, in ns
+#define HOST_NS(frames, code) ({ \
+  double start = hostNanos(); \
+  for (uint16_t f = 0; f < (frames); f++) { code; } \
+  (hostNanos() - start) / (frames); \
+})
+
+int checkResult() {
+  printf(gFailures ? "%d FAILED\n" : "OK\n", gFailures);
+  return gFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,48 @@
+// The 'b' and 'p' serial benchmarks leave the show as they found it
+#include "check.h"
+
+#define private public
+#include "HeartLEDSuit.ino"
+#undef private
+
+int main() {
+  for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = CRGB(i, 255 - i, i * 2);
+  gHue = 77;
+  gRenderingSettings = RIGHT_STRIP_ONLY;
+  palettes.moveToNextPalette();
+
+  CRGB frame[NUM_LEDS];
+  memcpy(frame, leds, sizeof(frame));
+  CRGBPalette16 working = palettes.getPalette();
+  uint8_t paletteIndex = palettes._paletteIndex;
+  uint32_t version = palettes.getVersion();
+
+  benchKernels();
+  expectEqual("leds changed by 'b'", memcmp(frame, leds, sizeof(frame)) != 0, 0);
+
+  // The sound animation's own state, as when it's the one showing
+  SoundAnimation sound;
+  FrameContext ctx = {0, 0, 0};
+  arena.beginOwner(ARENA_OWNER_DEBUG);
+  sound.init(ctx);
+  arena.endOwner();
+  sound._volume = 12;
+  sound._dotPos = 34;
+  sound._gradient = 56;
+  sound._volumeRatio = 78;
+  sound._bump = false;
+  sound.benchmark();
+  arena.release(ARENA_OWNER_DEBUG);
+  expectEqual("SoundAnimation fields changed by benchmark()",
+              sound._volume != 12 || sound._dotPos != 34 || sound._gradient != 56 || sound._volumeRatio != 78 || sound._bump, 0);
+
+  benchAnimations();
+  expectEqual("leds changed by 'p'", memcmp(frame, leds, sizeof(frame)) != 0, 0);
+  expectEqual("gHue changed by 'p'", gHue, 77);
+  expectEqual("strip mask changed by 'p'", gRenderingSettings, RIGHT_STRIP_ONLY);
+  expectEqual("working palette changed by 'p'", palettes.getPalette() != working, 0);
+  expectEqual("library palette changed by 'p'", palettes._paletteIndex, paletteIndex);
+  expectEqual("palette version went up", palettes.getVersion() > version, 1);
+
+  return checkResult();
+}
@@ -0,0 +1,247 @@
+// The fixed point sound and Fibonacci kernels against the float code they
+// replaced, and their host time before and after
+#include "check.h"
+
+#define private public
+#include "HeartLEDSuit.ino"
+#undef private
+
+#define BENCH_RUNS 2000
+
+// Float volumes of the old updateBumps()
+struct FloatVolumes {
+  float avgVol;
+  float maxVol;
+  float avgBump;
+  uint8_t lastVolume;
+  bool bump;
+
+  void update(uint8_t volume, bool decayMax) {
+    if (volume) {
+      avgVol = (avgVol + volume) / 2.0;
+      if (volume > maxVol) maxVol = volume;
+    }
+    avgVol = (avgVol + volume) / 2.0;
+
+    if (volume - lastVolume > 10) avgBump = (avgBump + (volume - lastVolume)) / 2.0;
+    bump = (volume - lastVolume > avgBump * 0.9);
+
+    if (decayMax) maxVol = (maxVol + volume) / 2.0;
+    lastVolume = volume;
+  }
+};
+
+// The old float soundPulse(), without the fade
+void floatSoundPulse(CRGB* frame, float ratio, uint8_t gradient) {
+  CRGB col = ColorFromPalette(palettes.getPalette(), gradient);
+  int start = HALF_LEDS - (HALF_LEDS * ratio);
+  int finish = HALF_LEDS + (HALF_LEDS * ratio) + NUM_LEDS % 2;
+
+  for (int i = start; i < finish; i++) {
+    float damp = sin((i - start) * PI / float(finish - start));
+    damp = pow(damp, 2.0);
+
+    CRGB col2 = frame[i];
+    CRGB color;
+    color.r = col.r * damp * pow(ratio, 2);
+    color.g = col.g * damp * pow(ratio, 2);
+    color.b = col.b * damp * pow(ratio, 2);
+
+    float avgCol = (color.r + color.g + color.b) / 3.0;
+    float avgCol2 = (col2.r + col2.g + col2.b) / 3.0;
+    if (avgCol > avgCol2) frame[i] = color;
+  }
+}
+
+// The old float paletteDance() frame
+void floatPaletteDance(CRGB* frame, float ratio, int dotPos) {
+  for (int i = 0; i < NUM_LEDS; i++) {
+    float sinVal = fabs(sin((i + dotPos) * (PI / float(NUM_LEDS / 1.25))));
+    sinVal *= sinVal;
+    sinVal *= ratio;
+
+    unsigned int val = 256 * (float(i + map(dotPos, -1 * (NUM_LEDS - 1), NUM_LEDS - 1, 0, NUM_LEDS - 1)) / float(NUM_LEDS)) + gHue;
+    val %= 256;
+    CRGB col = ColorFromPalette(palettes.getPalette(), val);
+    frame[i].r = col.r * sinVal;
+    frame[i].g = col.g * sinVal;
+    frame[i].b = col.b * sinVal;
+  }
+}
+
+// The old float bleed() around point
+void floatBleed(CRGB* frame, uint8_t point) {
+  for (int i = 1; i < NUM_LEDS; i++) {
+    int sides[] = {point - i, point + i};
+    for (int s = 0; s < 2; s++) {
+      int p = sides[s];
+      if (p < NUM_LEDS - 1 && p > 1) {
+        frame[p].r = float((frame[p - 1].r + frame[p].r + frame[p + 1].r) / 3.0);
+        frame[p].g = float((frame[p - 1].g + frame[p].g + frame[p + 1].g) / 3.0);
+        frame[p].b = float((frame[p - 1].b + frame[p].b + frame[p + 1].b) / 3.0);
+      }
+    }
+  }
+}
+
+uint8_t maxChannelError(const CRGB* a, const CRGB* b) {
+  uint8_t worst = 0;
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    for (uint8_t c = 0; c < 3; c++) {
+      uint8_t error = abs(a[i][c] - b[i][c]);
+      if (error > worst) worst = error;
+    }
+  }
+  return worst;
+}
+
+// Sets the sound animation to volume out of maxVolume through updateBumps()
+void setVolume(SoundAnimation& sound, uint8_t volume, uint8_t maxVolume) {
+  sound._maxVol = maxVolume << 8;
+  sound._gradient = 0;
+  sound._lastVolume = volume;
+  sound.updateBumps(volume);
+}
+
+void checkApproximations(SoundAnimation& sound) {
+  double sin2 = 0, square = 0, pow15 = 0;
+
+  for (uint16_t theta = 0; theta < 256; theta++) {
+    double s = sin(PI * theta / 256);
+    sin2 = fmax(sin2, fabs(sinSquared8(theta) - 255 * s * s));
+  }
+
+  // Every volume under every loudest volume, as the sound kernels see them
+  for (uint16_t maxVolume = 1; maxVolume < 256; maxVolume++) {
+    for (uint16_t volume = 0; volume <= maxVolume; volume++) {
+      setVolume(sound, volume, maxVolume);
+      double ratio = (double)volume / maxVolume;
+      square = fmax(square, fabs(square8(sound._volumeRatio) - 255 * ratio * ratio));
+      pow15 = fmax(pow15, fabs(pow15_8(sound._volumeRatio) - 255 * pow(ratio, 1.5)));
+    }
+  }
+
+  expectWithin("sinSquared8 vs 255 sin^2 (/255)", sin2, 0.5);
+  expectWithin("square8(volume ratio) vs 255 r^2 (/255)", square, 2);
+  expectWithin("pow15_8(volume ratio) vs 255 r^1.5 (/255)", pow15, 2);
+
+  long div3Errors = 0;
+  for (uint16_t x = 0; x <= 3 * 255; x++) div3Errors += div3(x) != x / 3;
+  expectEqual("div3 wrong results over 0-765", div3Errors, 0);
+
+  long pulseErrors = 0;
+  for (uint8_t step = 0; step < PULSE_MAX_STEPS; step++) {
+    double fade = pow(0.8, step - 2) * 255;
+    pulseErrors += PULSE_FADE[step] != (fade > 255 ? 255 : (uint8_t)fade);
+  }
+  expectEqual("PULSE_FADE entries off the float fade", pulseErrors, 0);
+}
+
+// The 8.8 averages against the float ones over a random volume track
+void checkAverages(SoundAnimation& sound) {
+  FloatVolumes reference = {0, 15, 0, 0, false};
+  sound._avgVol = 0;
+  sound._maxVol = 15 << 8;
+  sound._avgBump = 0;
+  sound._lastVolume = 0;
+
+  double avgVol = 0, maxVol = 0, avgBump = 0;
+  long bumps = 0, bumpMismatches = 0;
+  srand(1);
+
+  for (uint32_t frame = 0; frame < 100000; frame++) {
+    // Quiet with loud hits, like music through the mic
+    uint8_t volume = rand() % 4 == 0 ? rand() % 256 : rand() % 40;
+
+    bool decayMax = sound._gradient > 255;
+    sound.updateBumps(volume);
+    reference.update(volume, decayMax);
+
+    avgVol = fmax(avgVol, fabs(sound._avgVol / 256.0 - reference.avgVol));
+    maxVol = fmax(maxVol, fabs(sound._maxVol / 256.0 - reference.maxVol));
+    avgBump = fmax(avgBump, fabs(sound._avgBump / 256.0 - reference.avgBump));
+    bumps += reference.bump;
+    bumpMismatches += sound._bump != reference.bump;
+  }
+
+  expectWithin("8.8 avgVol vs float (volume steps)", avgVol, 1 / 256.0);
+  expectWithin("8.8 maxVol vs float (volume steps)", maxVol, 1 / 256.0);
+  expectWithin("8.8 avgBump vs float (volume steps)", avgBump, 1 / 256.0);
+  printf("%-44s %8ld  of %ld bumps\n", "bumps detected differently", bumpMismatches, bumps);
+}
+
+// Whole frames of the kernels against the old float ones
+void checkKernels(SoundAnimation& sound) {
+  CRGB reference[NUM_LEDS + 1];
+  uint8_t pulse = 0, dance = 0, bleedError = 0;
+
+  for (uint16_t maxVolume = 8; maxVolume < 256; maxVolume += 7) {
+    for (uint16_t volume = 1; volume <= maxVolume; volume += 3) {
+      setVolume(sound, volume, maxVolume);
+      float ratio = (float)volume / maxVolume;
+
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      fill_solid(reference, NUM_LEDS, CRGB::Black);
+      sound._gradient = volume;
+      sound._bump = false;
+      sound.soundPulse();
+      floatSoundPulse(reference, ratio, volume);
+      pulse = max(pulse, maxChannelError(leds, reference));
+
+      sound._dotPos = volume % 80;
+      sound._avgVol = 0;
+      sound.paletteDance();
+      floatPaletteDance(reference, ratio, volume % 80);
+      dance = max(dance, maxChannelError(leds, reference));
+    }
+  }
+
+  srand(2);
+  for (uint16_t run = 0; run < 1000; run++) {
+    for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = reference[i] = CRGB(rand(), rand(), rand());
+    uint8_t point = rand() % NUM_LEDS;
+    sound.bleed(point);
+    floatBleed(reference, point);
+    bleedError = max(bleedError, maxChannelError(leds, reference));
+  }
+
+  expectWithin("soundPulse frame vs float (/255)", pulse, 6);
+  expectWithin("paletteDance frame vs float (/255)", dance, 3);
+  expectEqual("bleed frame vs float (/255)", bleedError, 0);
+}
+
+// Host time per frame, float before and fixed point after. The host has an
+// FPU, the M0 emulates every float operation, so this understates the gain.
+void benchSoundKernels(SoundAnimation& sound) {
+  CRGB reference[NUM_LEDS + 1];
+  setVolume(sound, 200, 220);
+  float ratio = 200.0 / 220;
+  sound._avgVol = 0;
+  sound._bump = false;
+
+  printf("host ns/frame        float   fixed\n");
+  printf("soundPulse        %8.0f %7.0f\n",
+         HOST_NS(BENCH_RUNS, floatSoundPulse(reference, ratio, f)),
+         HOST_NS(BENCH_RUNS, sound._gradient = f; sound.soundPulse()));
+  printf("paletteDance      %8.0f %7.0f\n",
+         HOST_NS(BENCH_RUNS, floatPaletteDance(reference, ratio, f % 80)),
+         HOST_NS(BENCH_RUNS, sound._dotPos = f % 80; sound.paletteDance()));
+  printf("bleed             %8.0f %7.0f\n",
+         HOST_NS(BENCH_RUNS, floatBleed(reference, f % NUM_LEDS)),
+         HOST_NS(BENCH_RUNS, sound.bleed(f % NUM_LEDS)));
+}
+
+int main() {
+  SoundAnimation sound;
+  FrameContext ctx = {0, 0, 0};
+  arena.beginOwner(ARENA_OWNER_DEBUG);
+  sound.init(ctx);
+  arena.endOwner();
+
+  checkApproximations(sound);
+  checkAverages(sound);
+  checkKernels(sound);
+  benchSoundKernels(sound);
+
+  return checkResult();
+}
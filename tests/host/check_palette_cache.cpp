@@ -0,0 +1,51 @@
+// PaletteMgr::colorAt against ColorFromPalette on the working palette, and
+// their host time
+#include "check.h"
+
+#include "HeartLEDSuit.ino"
+
+#define BENCH_RUNS 20000
+
+// Colors of the working palette at every index and brightness that
+// colorAt() gets wrong
+long wrongColors() {
+  long wrong = 0;
+  for (uint16_t index = 0; index < 256; index++) {
+    for (uint16_t brightness = 0; brightness < 256; brightness++) {
+      CRGB expected = ColorFromPalette(palettes.getPalette(), index, brightness, LINEARBLEND);
+      wrong += palettes.colorAt(index, brightness) != expected;
+    }
+  }
+  return wrong;
+}
+
+int main() {
+  long wrong = 0, palettesChecked = 0;
+
+  // Every palette of the library, cutting to it and crossfading into it
+  for (uint8_t p = 0; p < gPaletteLibraryCount; p++) {
+    wrong += wrongColors();
+    palettesChecked++;
+
+    palettes.queueNextPalette(0);
+    for (uint32_t now = 0; now <= PALETTE_BLEND_MS; now += PALETTE_BLEND_MS / 8) {
+      palettes.update(now);
+      wrong += wrongColors();
+      palettesChecked++;
+    }
+  }
+  printf("%-44s %8ld\n", "working palettes checked", palettesChecked);
+  expectEqual("colorAt colors off ColorFromPalette", wrong, 0);
+
+  // A frame of palette pixels, as the palette animations draw them
+  printf("host ns/frame        ColorFromPalette   colorAt\n");
+  printf("100 px, full       %14.0f %9.0f\n",
+         HOST_NS(BENCH_RUNS, for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = ColorFromPalette(palettes.getPalette(), i + f, 255, LINEARBLEND)),
+         HOST_NS(BENCH_RUNS, for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = palettes.colorAt(i + f)));
+  printf("100 px, dimmed     %14.0f %9.0f\n",
+         HOST_NS(BENCH_RUNS, for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = ColorFromPalette(palettes.getPalette(), i + f, i, LINEARBLEND)),
+         HOST_NS(BENCH_RUNS, for (uint8_t i = 0; i < NUM_LEDS; i++) leds[i] = palettes.colorAt(i + f, i)));
+  printf("cache RAM (bytes): %u\n", (unsigned)(256 * sizeof(CRGB)));
+
+  return checkResult();
+}
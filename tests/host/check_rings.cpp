@@ -0,0 +1,92 @@
+// drawRing and drawDisc against rings drawn from the exact distance, and
+// against the drawCircle they replaced in Pulse
+#include "check.h"
+
+#include "HeartLEDSuit.ino"
+
+#define BENCH_RUNS 20000
+
+// Coverage of a LED at distance from the center, with a linear edge
+// halfWidth wide on both sides of the radius
+double exactCoverage(double distance, uint8_t radius, uint8_t width, bool filled) {
+  double halfWidth = max(width / 2, 1);
+  double error = distance - radius;
+  if (error < 0) error = filled ? 0 : -error;
+  return error >= halfWidth ? 0 : 255 * (1 - error / halfWidth);
+}
+
+uint8_t litLeds() {
+  uint8_t lit = 0;
+  for (uint8_t i = 0; i < NUM_LEDS; i++) lit += leds[i] != CRGB(CRGB::Black);
+  return lit;
+}
+
+// Worst coverage error of the rounds of at least minRadius, over the
+// whole suit from centers all over it
+double worstCoverage(uint8_t width, bool filled, uint8_t minRadius) {
+  double worst = 0;
+
+  for (uint16_t center = 0; center < NUM_LEDS; center += 3) {
+    uint8_t x = ledGeometry.mX[center];
+    uint8_t y = ledGeometry.mY[center];
+
+    for (uint16_t radius = minRadius; radius < 256; radius += 2) {
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      drawRound(x, y, radius, width, CRGB::White, filled);
+
+      for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        double distance = hypot(ledGeometry.mX[i] - x, ledGeometry.mY[i] - y);
+        // On white over black the LED is the coverage
+        worst = fmax(worst, fabs(leds[i].r - exactCoverage(distance, radius, width, filled)));
+      }
+    }
+  }
+
+  return worst;
+}
+
+int main() {
+  // The squared distance edge bends away from the linear one, less as the
+  // radius grows
+  expectWithin("ring w12 coverage vs exact (/255)", worstCoverage(PULSE_RING_WIDTH, false, 0), 10);
+  expectWithin("ring w12 r>=64 coverage vs exact (/255)", worstCoverage(PULSE_RING_WIDTH, false, 64), 5);
+  expectWithin("ring w16 r>=64 coverage vs exact (/255)", worstCoverage(RIPPLE2D_RING_WIDTH, false, 64), 5);
+  expectWithin("disc w12 coverage vs exact (/255)", worstCoverage(PULSE_RING_WIDTH, true, 0), 10);
+
+  // Pulse's rings, step by step: its old circles on the 32x32 grid and the
+  // rings that replaced them on the 256x256 coordinates
+  uint32_t circleLeds = 0, ringLeds = 0, circleMisses = 0, rings = 0;
+  for (uint8_t center = 0; center < NUM_LEDS; center += 3) {
+    uint8_t x = coordsX32[physicalToFibonacciOrder[center]];
+    uint8_t y = coordsY32[physicalToFibonacciOrder[center]];
+
+    for (uint8_t step = 1; step < PULSE_MAX_STEPS; step++) {
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      drawCircle(x, y, step, CRGB::White);
+      uint8_t circle = litLeds();
+
+      drawRing(ledGeometry.mX[center], ledGeometry.mY[center], step * PULSE_STEP_RADIUS, PULSE_RING_WIDTH, CRGB::Red);
+      uint8_t both = litLeds();
+
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      drawRing(ledGeometry.mX[center], ledGeometry.mY[center], step * PULSE_STEP_RADIUS, PULSE_RING_WIDTH, CRGB::Red);
+      uint8_t ring = litLeds();
+
+      circleLeds += circle;
+      ringLeds += ring;
+      // LEDs of the circle the ring leaves dark
+      circleMisses += both - ring;
+      rings++;
+    }
+  }
+  printf("%-44s %8.2f\n", "LEDs lit per Pulse step, drawCircle", (double)circleLeds / rings);
+  printf("%-44s %8.2f\n", "LEDs lit per Pulse step, drawRing", (double)ringLeds / rings);
+  printf("%-44s %8.2f\n", "circle LEDs the ring leaves dark per step", (double)circleMisses / rings);
+
+  printf("host ns/call\n");
+  printf("drawCircle r8 (32x32)      %7.0f\n", HOST_NS(BENCH_RUNS, drawCircle(16, 16, 8, CRGB(f, 0, 0))));
+  printf("drawRing r64 w12           %7.0f\n", HOST_NS(BENCH_RUNS, drawRing(128, 128, 64, PULSE_RING_WIDTH, CRGB(f, 0, 0))));
+  printf("drawDisc r64 w12           %7.0f\n", HOST_NS(BENCH_RUNS, drawDisc(128, 128, 64, PULSE_RING_WIDTH, CRGB(f, 0, 0))));
+
+  return checkResult();
+}
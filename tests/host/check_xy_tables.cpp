@@ -0,0 +1,77 @@
+// setPixelXY and setPixelXY10 against the scans over all the LEDs they
+// replaced, and their host time before and after
+#include "check.h"
+
+#include "HeartLEDSuit.ino"
+
+#define BENCH_RUNS 2000
+
+// The old setPixelXY10(): every LED of the cell
+void scanPixelXY10(CRGB* frame, uint8_t x, uint8_t y, CRGB color) {
+  if (x >= 10 || y >= 10) return;
+
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    uint8_t o = physicalToFibonacciOrder[i];
+    if (coordsX10[o] == x && coordsY10[o] == y) frame[i] = color;
+  }
+}
+
+// The old setPixelXY(): the first LED of the cell
+void scanPixelXY(CRGB* frame, uint8_t x, uint8_t y, CRGB color) {
+  if (x >= kMatrixWidth || y >= kMatrixHeight) return;
+
+  for (uint8_t i = 0; i < NUM_LEDS; i++) {
+    uint8_t o = physicalToFibonacciOrder[i];
+    if (coordsX32[o] == x && coordsY32[o] == y) {
+      frame[i] = color;
+      return;
+    }
+  }
+}
+
+// A color per cell, so that a LED lit from the wrong cell shows
+CRGB cellColor(uint8_t x, uint8_t y) {
+  return CRGB(x * 8 + 1, y * 8 + 1, 1);
+}
+
+int main() {
+  CRGB reference[NUM_LEDS + 1];
+  long cellErrors = 0;
+
+  // Cell by cell so that a LED lit by two cells can't hide the first one
+  for (uint8_t y = 0; y < kMatrixHeight + 1; y++) {
+    for (uint8_t x = 0; x < kMatrixWidth + 1; x++) {
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      fill_solid(reference, NUM_LEDS, CRGB::Black);
+      setPixelXY(x, y, cellColor(x, y));
+      scanPixelXY(reference, x, y, cellColor(x, y));
+      cellErrors += memcmp(leds, reference, NUM_LEDS * sizeof(CRGB)) != 0;
+    }
+  }
+  expectEqual("32x32 cells lighting other LEDs than the scan", cellErrors, 0);
+
+  cellErrors = 0;
+  for (uint8_t y = 0; y < 11; y++) {
+    for (uint8_t x = 0; x < 11; x++) {
+      fill_solid(leds, NUM_LEDS, CRGB::Black);
+      fill_solid(reference, NUM_LEDS, CRGB::Black);
+      setPixelXY10(x, y, cellColor(x, y));
+      scanPixelXY10(reference, x, y, cellColor(x, y));
+      cellErrors += memcmp(leds, reference, NUM_LEDS * sizeof(CRGB)) != 0;
+    }
+  }
+  expectEqual("10x10 cells lighting other LEDs than the scan", cellErrors, 0);
+
+  // A whole grid drawn per frame, as Life does
+  printf("host ns/frame        scan   table\n");
+  printf("setPixelXY 32x32  %7.0f %7.0f\n",
+         HOST_NS(BENCH_RUNS, for (uint16_t c = 0; c < 1024; c++) scanPixelXY(reference, c & 31, c >> 5, CRGB(f, c, 0))),
+         HOST_NS(BENCH_RUNS, for (uint16_t c = 0; c < 1024; c++) setPixelXY(c & 31, c >> 5, CRGB(f, c, 0))));
+  printf("setPixelXY10      %7.0f %7.0f\n",
+         HOST_NS(BENCH_RUNS, for (uint8_t c = 0; c < 100; c++) scanPixelXY10(reference, c % 10, c / 10, CRGB(f, c, 0))),
+         HOST_NS(BENCH_RUNS, for (uint8_t c = 0; c < 100; c++) setPixelXY10(c % 10, c / 10, CRGB(f, c, 0))));
+  printf("flash tables (bytes): xyToLed %u, xy10Starts %u, xy10Leds %u\n",
+         (unsigned)sizeof(xyToLed), (unsigned)sizeof(xy10Starts), (unsigned)sizeof(xy10Leds));
+
+  return checkResult();
+}
@@ -0,0 +1,50 @@
+#pragma once
+// Host stand-in for the Arduino core, just enough to build the sketch into
+// the checks of tests/host. Time stands still: millis() and micros() are 0.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <new>
+typedef uint8_t byte;
+typedef bool boolean;
+#define PI 3.1415926535897932384626433832795
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A1 15
+#define A4 18
+#define A7 21
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+inline uint32_t millis() { return 0; }
+inline uint32_t micros() { return 0; }
+inline void delay(uint32_t) {}
+inline void delayMicroseconds(uint32_t) {}
+inline void yield() {}
+inline int analogRead(int) { return 0; }
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return 0; }
+inline long random(long m) { return rand() % (m ? m : 1); }
+inline long random(long a, long b) { return a + random(b - a); }
+inline void randomSeed(unsigned long) {}
+inline long map(long x, long a, long b, long c, long d) { return (x - a) * (d - c) / (b - a) + c; }
+class String { public: String(const char*) {} String(int) {} String(long) {} String(unsigned) {} String(unsigned long) {} String(float) {} String(double) {} };
+class SerialStub { public:
+  void begin(long) {}
+  template <class T> void print(T) {}
+  template <class T> void print(T, int) {}
+  template <class T> void println(T) {}
+  template <class T> void println(T, int) {}
+  void println() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  operator bool() { return true; }
+};
+extern SerialStub Serial;
@@ -0,0 +1,142 @@
+#include "FastLED.h"
+
+SerialStub Serial;
+CFastLED FastLED;
+
+// Copied from FastLED's colorpalettes.cpp
+const TProgmemRGBPalette16 CloudColors_p = {
+  0x0000FF, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B,
+  0x0000FF, 0x00008B, 0x87CEEB, 0x87CEEB, 0xADD8E6, 0xFFFFFF, 0xADD8E6, 0x87CEEB
+};
+const TProgmemRGBPalette16 LavaColors_p = {
+  0x000000, 0x800000, 0x000000, 0x800000, 0x8B0000, 0x8B0000, 0x800000, 0x8B0000,
+  0x8B0000, 0x8B0000, 0xFF0000, 0xFFA500, 0xFFFFFF, 0xFFA500, 0xFF0000, 0x8B0000
+};
+const TProgmemRGBPalette16 OceanColors_p = {
+  0x191970, 0x00008B, 0x191970, 0x000080, 0x00008B, 0x0000CD, 0x2E8B57, 0x008080,
+  0x5F9EA0, 0x0000FF, 0x008B8B, 0x6495ED, 0x7FFFD4, 0x2E8B57, 0x00FFFF, 0x87CEFA
+};
+const TProgmemRGBPalette16 ForestColors_p = {
+  0x006400, 0x006400, 0x556B2F, 0x006400, 0x008000, 0x228B22, 0x6B8E23, 0x008000,
+  0x2E8B57, 0x66CDAA, 0x32CD32, 0x9ACD32, 0x90EE90, 0x7CFC00, 0x66CDAA, 0x228B22
+};
+const TProgmemRGBPalette16 RainbowColors_p = {
+  0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00, 0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+  0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5, 0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B
+};
+const TProgmemRGBPalette16 RainbowStripeColors_p = {
+  0xFF0000, 0x000000, 0xAB5500, 0x000000, 0xABAB00, 0x000000, 0x00FF00, 0x000000,
+  0x00AB55, 0x000000, 0x0000FF, 0x000000, 0x5500AB, 0x000000, 0xAB0055, 0x000000
+};
+const TProgmemRGBPalette16 PartyColors_p = {
+  0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+  0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E, 0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9
+};
+const TProgmemRGBPalette16 HeatColors_p = {
+  0x000000, 0x330000, 0x660000, 0x990000, 0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600,
+  0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33, 0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF
+};
+
+// FastLED's colorutils.cpp, with FASTLED_SCALE8_FIXED
+CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness, TBlendType blendType) {
+  uint8_t hi4 = index >> 4;
+  uint8_t lo4 = index & 0x0F;
+
+  CRGB color = pal[hi4];
+
+  if (lo4 && blendType != NOBLEND) {
+    const CRGB& next = pal[(hi4 + 1) & 0x0F];
+    uint8_t f2 = lo4 << 4;
+    uint8_t f1 = 255 - f2;
+    for (uint8_t c = 0; c < 3; c++) color[c] = scale8(color[c], f1) + scale8(next[c], f2);
+  }
+
+  if (brightness != 255) {
+    if (brightness) {
+      brightness++;  // adjust for rounding
+      for (uint8_t c = 0; c < 3; c++) if (color[c]) color[c] = scale8(color[c], brightness);
+    } else {
+      color = CRGB::Black;
+    }
+  }
+
+  return color;
+}
+
+void fill_solid(CRGB* leds, int n, const CRGB& c) {
+  for (int i = 0; i < n; i++) leds[i] = c;
+}
+
+void fill_palette(CRGB* L, uint16_t N, uint8_t startIndex, uint8_t incIndex, const CRGBPalette16& pal, uint8_t brightness, TBlendType blendType) {
+  uint8_t colorIndex = startIndex;
+  for (uint16_t i = 0; i < N; i++) {
+    L[i] = ColorFromPalette(pal, colorIndex, brightness, blendType);
+    colorIndex += incIndex;
+  }
+}
+
+void nscale8(CRGB* leds, uint16_t n, uint8_t s) {
+  for (uint16_t i = 0; i < n; i++) leds[i].nscale8(s);
+}
+
+void fadeToBlackBy(CRGB* leds, uint16_t n, uint8_t f) {
+  nscale8(leds, n, 255 - f);
+}
+
+void fadeLightBy(CRGB* leds, uint16_t n, uint8_t f) {
+  for (uint16_t i = 0; i < n; i++) leds[i].nscale8_video(255 - f);
+}
+
+CRGB& nblend(CRGB& existing, const CRGB& overlay, fract8 amount) {
+  if (amount == 0) return existing;
+  if (amount == 255) return existing = overlay;
+  for (uint8_t c = 0; c < 3; c++) {
+    existing[c] = scale8(existing[c], 255 - amount) + scale8(overlay[c], amount);
+  }
+  return existing;
+}
+
+CRGB blend(const CRGB& a, const CRGB& b, fract8 amount) {
+  CRGB result = a;
+  return nblend(result, b, amount);
+}
+
+void nblendPaletteTowardPalette(CRGBPalette16& current, CRGBPalette16& target, uint8_t maxChanges) {
+  uint8_t* p1 = (uint8_t*)current.entries;
+  uint8_t* p2 = (uint8_t*)target.entries;
+  uint8_t changes = 0;
+
+  for (uint8_t i = 0; i < sizeof(current.entries); i++) {
+    if (p1[i] == p2[i]) continue;
+    if (p1[i] < p2[i]) { p1[i]++; changes++; }
+    if (p1[i] > p2[i]) { p1[i]--; changes++; if (p1[i] > p2[i]) p1[i]--; }
+    if (changes >= maxChanges) break;
+  }
+}
+
+void blur1d(CRGB* leds, uint16_t n, fract8 amount) {
+  uint8_t keep = 255 - amount;
+  uint8_t seep = amount >> 1;
+  CRGB carryover = CRGB::Black;
+  for (uint16_t i = 0; i < n; i++) {
+    CRGB cur = leds[i];
+    CRGB part = cur;
+    part.nscale8(seep);
+    cur.nscale8(keep);
+    cur += carryover;
+    if (i) leds[i - 1] += part;
+    leds[i] = cur;
+    carryover = part;
+  }
+}
+
+// FastLED's power_mgt.cpp defaults, in mW at full brightness
+uint32_t calculate_unscaled_power_mW(const CRGB* ledbuffer, uint16_t numLeds) {
+  uint32_t red = 0, green = 0, blue = 0;
+  for (uint16_t i = 0; i < numLeds; i++) {
+    red += ledbuffer[i].r;
+    green += ledbuffer[i].g;
+    blue += ledbuffer[i].b;
+  }
+  return ((red * 16 * 5) >> 8) + ((green * 11 * 5) >> 8) + ((blue * 15 * 5) >> 8) + numLeds * 5;
+}
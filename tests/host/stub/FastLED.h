@@ -0,0 +1,145 @@
+#pragma once
+// Host stand-in for FastLED 3.1. The color math the checks compare against
+// (scale8, nblend, ColorFromPalette) follows FastLED built with
+// FASTLED_SCALE8_FIXED, the waves and the randomness don't.
+#include "Arduino.h"
+#define FASTLED_VERSION 3001005
+#define FL_PROGMEM
+#define PROGMEM
+typedef uint8_t fract8;
+typedef uint16_t accum88;
+inline uint8_t scale8(uint8_t i, fract8 s) { return ((uint16_t)i * (1 + s)) >> 8; }
+inline uint8_t scale8_video(uint8_t i, fract8 s) { return (((int)i * s) >> 8) + ((i && s) ? 1 : 0); }
+inline uint16_t scale16(uint16_t i, uint16_t s) { return ((uint32_t)i * (1 + (uint32_t)s)) >> 16; }
+inline uint16_t scale16by8(uint16_t i, fract8 s) { return (i * (1 + (uint16_t)s)) >> 8; }
+inline uint8_t qadd8(uint8_t a, uint8_t b) { int t = a + b; return t > 255 ? 255 : t; }
+inline uint8_t qsub8(uint8_t a, uint8_t b) { int t = a - b; return t < 0 ? 0 : t; }
+inline uint8_t addmod8(uint8_t a, uint8_t b, uint8_t m) { a += b; while (a >= m) a -= m; return a; }
+inline uint8_t sin8(uint8_t t) { return (uint8_t)(128 + 127 * sin(t * 2 * PI / 256)); }
+inline uint8_t cos8(uint8_t t) { return sin8(t + 64); }
+inline int16_t sin16(uint16_t t) { return (int16_t)(32767 * sin(t * 2 * PI / 65536)); }
+inline int16_t cos16(uint16_t t) { return sin16(t + 16384); }
+inline uint8_t cubicwave8(uint8_t i) { return i; }
+inline uint8_t quadwave8(uint8_t i) { return i; }
+inline uint8_t triwave8(uint8_t i) { return i; }
+inline uint8_t ease8InOutQuad(uint8_t i) { return i; }
+inline uint8_t ease8InOutCubic(uint8_t i) { return i; }
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 f) { return a + scale8(b - a, f); }
+inline uint8_t sqrt16(uint16_t x) { return (uint8_t)sqrt((double)x); }
+inline uint8_t random8() { return rand(); }
+inline uint8_t random8(uint8_t lim) { return (random8() * lim) >> 8; }
+inline uint8_t random8(uint8_t a, uint8_t b) { return a + random8(b - a); }
+inline uint16_t random16() { return rand(); }
+inline uint16_t random16(uint16_t lim) { return ((uint32_t)random16() * lim) >> 16; }
+inline uint16_t random16(uint16_t a, uint16_t b) { return a + random16(b - a); }
+inline void random16_add_entropy(uint16_t) {}
+inline void random16_set_seed(uint16_t) {}
+inline uint8_t beat8(accum88, uint32_t = 0) { return 0; }
+inline uint16_t beat16(accum88, uint32_t = 0) { return 0; }
+inline uint8_t beatsin8(accum88, uint8_t lo = 0, uint8_t hi = 255, uint32_t = 0, uint8_t = 0) { return lo + (hi - lo) / 2; }
+inline uint16_t beatsin16(accum88, uint16_t lo = 0, uint16_t = 65535, uint32_t = 0, uint16_t = 0) { return lo; }
+inline uint16_t beatsin88(accum88, uint16_t lo = 0, uint16_t = 65535, uint32_t = 0, uint16_t = 0) { return lo; }
+struct CHSV { uint8_t h, s, v; CHSV() {} CHSV(uint8_t a, uint8_t b, uint8_t c) : h(a), s(b), v(c) {} };
+typedef enum { HUE_RED = 0, HUE_ORANGE = 32, HUE_YELLOW = 64, HUE_GREEN = 96, HUE_AQUA = 128, HUE_BLUE = 160, HUE_PURPLE = 192, HUE_PINK = 224 } HSVHue;
+struct CRGB {
+  union { struct { uint8_t r, g, b; }; uint8_t raw[3]; };
+  CRGB() {}
+  CRGB(uint8_t a, uint8_t b_, uint8_t c) : r(a), g(b_), b(c) {}
+  CRGB(uint32_t c) : r(c >> 16), g(c >> 8), b(c) {}
+  CRGB(const CHSV& h) : r(h.v), g(h.s), b(h.h) {}
+  CRGB& operator=(uint32_t c) { r = c >> 16; g = c >> 8; b = c; return *this; }
+  CRGB& operator=(const CHSV& h) { r = h.v; g = h.s; b = h.h; return *this; }
+  uint8_t& operator[](uint8_t x) { return raw[x]; }
+  const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+  CRGB& nscale8(uint8_t s) { r = scale8(r, s); g = scale8(g, s); b = scale8(b, s); return *this; }
+  CRGB& nscale8_video(uint8_t s) { r = scale8_video(r, s); g = scale8_video(g, s); b = scale8_video(b, s); return *this; }
+  CRGB& fadeToBlackBy(uint8_t f) { return nscale8(255 - f); }
+  CRGB& fadeLightBy(uint8_t f) { return nscale8_video(255 - f); }
+  CRGB& setRGB(uint8_t a, uint8_t b_, uint8_t c) { r = a; g = b_; b = c; return *this; }
+  CRGB& operator+=(const CRGB& o) { r = qadd8(r, o.r); g = qadd8(g, o.g); b = qadd8(b, o.b); return *this; }
+  CRGB& operator|=(const CRGB& o) { if (o.r > r) r = o.r; if (o.g > g) g = o.g; if (o.b > b) b = o.b; return *this; }
+  CRGB& operator-=(const CRGB& o) { r = qsub8(r, o.r); g = qsub8(g, o.g); b = qsub8(b, o.b); return *this; }
+  CRGB& operator%=(uint8_t s) { return nscale8_video(s); }
+  uint8_t getAverageLight() const { return (r + g + b) / 3; }
+  uint8_t getLuma() const { return (r + g + b) / 3; }
+  explicit operator bool() const { return r || g || b; }
+  bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+  bool operator!=(const CRGB& o) const { return !(*this == o); }
+  typedef enum { Black = 0, White = 0xFFFFFF, Red = 0xFF0000, Green = 0x008000, Blue = 0x0000FF, Aqua = 0x00FFFF, Gray = 0x808080, FairyLight = 0xFFE42D, DarkBlue = 0x00008B, Orange = 0xFFA500, Yellow = 0xFFFF00, Purple = 0x800080, Magenta = 0xFF00FF } HTMLColorCode;
+};
+inline CRGB operator+(const CRGB& a, const CRGB& b) { CRGB r = a; r += b; return r; }
+typedef uint32_t TProgmemRGBPalette16[16];
+typedef const uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte* TProgmemRGBGradientPalettePtr;
+#define DEFINE_GRADIENT_PALETTE(X) extern const uint8_t X[] FL_PROGMEM; const uint8_t X[] FL_PROGMEM =
+struct CRGBPalette16 {
+  CRGB entries[16];
+  CRGBPalette16() {}
+  CRGBPalette16(const CRGB& c) { for (int i = 0; i < 16; i++) entries[i] = c; }
+  CRGBPalette16(const CRGB& a, const CRGB& b, const CRGB& c, const CRGB& d) { for (int i = 0; i < 16; i++) entries[i] = i < 4 ? a : i < 8 ? b : i < 12 ? c : d; }
+  CRGBPalette16(const TProgmemRGBPalette16& p) { for (int i = 0; i < 16; i++) entries[i] = p[i]; }
+  CRGBPalette16(TProgmemRGBGradientPalettePtr) {}
+  CRGBPalette16& operator=(const TProgmemRGBPalette16& p) { for (int i = 0; i < 16; i++) entries[i] = p[i]; return *this; }
+  CRGBPalette16& operator=(TProgmemRGBGradientPalettePtr) { return *this; }
+  CRGB& operator[](uint8_t x) { return entries[x]; }
+  const CRGB& operator[](uint8_t x) const { return entries[x]; }
+  bool operator==(const CRGBPalette16& o) const { return memcmp(entries, o.entries, sizeof(entries)) == 0; }
+  bool operator!=(const CRGBPalette16& o) const { return !(*this == o); }
+};
+extern const TProgmemRGBPalette16 RainbowColors_p, RainbowStripeColors_p, LavaColors_p, HeatColors_p, CloudColors_p, OceanColors_p, ForestColors_p, PartyColors_p;
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+void fill_solid(CRGB* leds, int n, const CRGB& c);
+void fill_palette(CRGB* L, uint16_t N, uint8_t startIndex, uint8_t incIndex, const CRGBPalette16& pal, uint8_t brightness, TBlendType blendType);
+void fadeToBlackBy(CRGB* leds, uint16_t n, uint8_t f);
+void fadeLightBy(CRGB* leds, uint16_t n, uint8_t f);
+void nscale8(CRGB* leds, uint16_t n, uint8_t s);
+CRGB& nblend(CRGB& existing, const CRGB& overlay, fract8 amount);
+CRGB blend(const CRGB& a, const CRGB& b, fract8 amount);
+void nblendPaletteTowardPalette(CRGBPalette16& current, CRGBPalette16& target, uint8_t maxChanges);
+void blur1d(CRGB* leds, uint16_t n, fract8 amount);
+uint32_t calculate_unscaled_power_mW(const CRGB* ledbuffer, uint16_t numLeds);
+uint8_t calculate_max_brightness_for_power_mW(const CRGB* ledbuffer, uint16_t numLeds, uint8_t target_brightness, uint32_t max_power_mW);
+void set_max_power_in_volts_and_milliamps(uint8_t, uint32_t);
+void show_at_max_brightness_for_power();
+void delay_at_max_brightness_for_power(uint16_t ms);
+enum ESPIChipsets { NEOPIXEL };
+enum LEDColorCorrection { TypicalLEDStrip = 0xFFB0F0 };
+class CLEDController { public:
+  CLEDController& setCorrection(LEDColorCorrection) { return *this; }
+  CLEDController& setLeds(CRGB* d, int n) { data = d; count = n; return *this; }
+  int size() { return count; }
+  CRGB* leds() { return data; }
+  void showLeds(uint8_t = 255) {}
+  CRGB* data; int count;
+};
+class CFastLED { public:
+  template <ESPIChipsets C, uint8_t PIN> CLEDController& addLeds(CRGB*, int, int = 0) { return ctrl[0]; }
+  void setBrightness(uint8_t b) { bri = b; }
+  uint8_t getBrightness() { return bri; }
+  void show() {}
+  void show(uint8_t) {}
+  void delay(unsigned long) {}
+  void clear(bool = false) {}
+  uint16_t getFPS() { return 0; }
+  int count() { return 4; }
+  CLEDController& operator[](int x) { return ctrl[x]; }
+  CLEDController ctrl[4]; uint8_t bri;
+};
+extern CFastLED FastLED;
+#define EVERY_N_MILLISECONDS(N) if (millis() % ((N) != 0 ? (N) : 1) == 0)
+#define EVERY_N_SECONDS(N) EVERY_N_MILLISECONDS((N) * 1000)
+#define EVERY_N_MILLIS(N) EVERY_N_MILLISECONDS(N)
+class CEveryNMillis { public:
+  uint32_t mPrevTrigger; uint32_t mPeriod;
+  CEveryNMillis() { reset(); mPeriod = 1; }
+  CEveryNMillis(uint32_t period) { reset(); setPeriod(period); }
+  void setPeriod(uint32_t p) { mPeriod = p; }
+  uint32_t getPeriod() { return mPeriod; }
+  uint32_t getElapsed() { return millis() - mPrevTrigger; }
+  bool ready() { bool r = getElapsed() >= mPeriod; if (r) reset(); return r; }
+  void reset() { mPrevTrigger = millis(); }
+  void trigger() { mPrevTrigger = millis() - mPeriod; }
+  operator bool() { return ready(); }
+};
+#define FL_PGM_READ_WORD_NEAR(x) (*(const uint16_t*)(x))